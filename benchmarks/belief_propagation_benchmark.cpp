@@ -0,0 +1,91 @@
+// Time of a full belief propagation solve on the decks of Cuckoo (52 cards of 13 ranks), Agram
+// (35 distinct cards) and Goofspiel (13 distinct cards), after some of the cards have been seen.
+// The kernels are those of `BELIEF_SG_SIMD` ("scalar", "avx2" or "avx512"), the best available by
+// default. The benchmark only uses the interface of `BeliefPropagation`, so it also builds against
+// older versions of the library to compare them.
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Belief-SG/core/state.h"
+// Older versions have no SIMD kernels
+#if __has_include("Belief-SG/core/belief_propagation_kernels.h")
+#include "Belief-SG/core/belief_propagation_kernels.h"
+#define BELIEF_SG_HAS_KERNELS
+#endif
+
+namespace {
+
+using belief_sg::BeliefPropagation;
+
+// Microseconds per solve of a deck of `n_pieces` pieces holding `copies` copies of each of
+// `n_values` values. A quarter of the pieces are known and another quarter have lost about a
+// third of their values. Two sets of domains alternate, so that no solve starts from the last one.
+double time_solve(int n_pieces, int n_values, int copies, int n_solves) {
+    BeliefPropagation belief_propagation(n_pieces, n_values, std::vector<int>(n_values, copies));
+    std::mt19937 generator(1);
+    std::vector<int> values;
+    for (int value = 0; value < n_values; ++value) {
+        values.insert(values.end(), copies, value);
+    }
+    std::shuffle(values.begin(), values.end(), generator);
+
+    std::vector<std::vector<bool>> domains(n_pieces, std::vector<bool>(n_values, true));
+    for (int piece = 0; piece < n_pieces / 4; ++piece) {
+        domains[piece].assign(n_values, false);
+        domains[piece][values[piece]] = true;
+    }
+    for (int piece = n_pieces / 4; piece < n_pieces / 2; ++piece) {
+        for (int value = 0; value < n_values; ++value) {
+            if (value != values[piece] && generator() % 3 == 0) {
+                domains[piece][value] = false;
+            }
+        }
+    }
+    std::vector<std::vector<bool>> other_domains = domains;
+    other_domains[n_pieces - 1][values[n_pieces - 1] == 0 ? 1 : 0] = false;
+
+    double checksum = 0.0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int solve = 0; solve < n_solves; ++solve) {
+        belief_propagation.update_probabilities(solve % 2 == 0 ? domains : other_domains);
+        checksum += belief_propagation.get_probability(n_pieces - 1, 0);
+    }
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum < 0.0) {
+        std::cout << checksum << "\n";
+    }
+    return elapsed.count() / n_solves;
+}
+
+#ifdef BELIEF_SG_HAS_KERNELS
+std::string level_name(belief_sg::SimdLevel level) {
+    switch (level) {
+        case belief_sg::SimdLevel::Scalar:
+            return "scalar";
+        case belief_sg::SimdLevel::AVX2:
+            return "avx2";
+        case belief_sg::SimdLevel::AVX512:
+            return "avx512";
+    }
+    return "unknown";
+}
+#endif
+
+}  // namespace
+
+int main() {
+#ifdef BELIEF_SG_HAS_KERNELS
+    std::cout << "Kernels: " << level_name(belief_sg::detected_simd_level()) << "\n";
+#endif
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Cuckoo 52x13:    " << time_solve(52, 13, 4, 200) << " us per solve\n";
+    std::cout << "Agram 35x35:     " << time_solve(35, 35, 1, 200) << " us per solve\n";
+    std::cout << "Goofspiel 13x13: " << time_solve(13, 13, 1, 2000) << " us per solve\n";
+    return 0;
+}
@@ -1,32 +1,75 @@
 #ifndef BELIEF_SG_AGENTS_DETERMINIZED_MC_H
 #define BELIEF_SG_AGENTS_DETERMINIZED_MC_H
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <random>
+#include <span>
+#include <vector>
 
 #include "Belief-SG/core/agent.h"
 #include "Belief-SG/core/game.h"
 #include "Belief-SG/core/player_id.h"
 #include "Belief-SG/core/state.h"
 #include "Belief-SG/core/action.h"
+#include "Belief-SG/core/thread_pool.h"
 
 namespace belief_sg {
 
+// Measurements of the last decision of a DeterminizedMC
+struct DeterminizedMCStats {
+    int n_playouts = 0;
+    int n_threads = 1;
+    // Time spent in playouts, summed over the threads
+    double playout_seconds = 0.0;
+    // Time of the whole decision, determinizations included
+    double decision_seconds = 0.0;
+
+    [[nodiscard]] double seconds_per_playout() const {
+        return n_playouts == 0 ? 0.0 : playout_seconds / n_playouts;
+    }
+};
+
 class DeterminizedMC : public Agent {
 public:
     DeterminizedMC();
     explicit DeterminizedMC(int n_samples, int n_iterations, bool use_prob);
     void set_game(std::shared_ptr<Game> game) override;
     void set_player(PlayerId player) override;
+    void set_seed(std::uint64_t seed) override;
     Action act(const State& private_state, const State& public_state) override;
+
+    // The playouts of each (action, determinization) pair are a task of a pool of `n_threads`
+    // threads. Each task draws its random numbers from its own numbered stream of a seed drawn by
+    // the agent's generator, so that the decisions do not depend on the number of threads.
+    void set_n_threads(int n_threads);
+    // With a non-zero budget, each decision returns once `time_budget` has elapsed since it
+    // started, instead of after `n_iterations` playouts. Every thread then repeatedly draws a new
+    // determinization and plays each action out once from it.
+    void set_time_budget(std::chrono::milliseconds time_budget);
+
+    [[nodiscard]] const DeterminizedMCStats& stats() const;
 private:
 
-    struct ActionInfo {
-        Action action;
-        double total_reward;
-        int visit_count;
+    // Playouts of one action
+    struct WorkItem {
+        std::uint64_t seed;
+        int action_id;
+        double total_reward = 0.0;
+        int visit_count = 0;
+        double seconds = 0.0;
     };
 
+    // Playouts of one action from one determinization
+    void run_playouts(const Action& action, const State& determinized_state, WorkItem& item) const;
+    // Playouts of every action until the deadline, from new determinizations of `private_state`.
+    // `items` holds one item per action, the first one gives the seed and receives the time.
+    void run_timed_playouts(const State& private_state, const std::vector<ProbAction>& actions, std::span<WorkItem> items, std::chrono::steady_clock::time_point deadline) const;
+    // Returns the reward of the player after playing `action` out from `state`, which is left
+    // unchanged
+    double playout(const Action& action, State& state, std::mt19937& generator) const;
+
     std::shared_ptr<Game> game_;
     PlayerId player_{0};
 
@@ -34,6 +77,11 @@ private:
     int n_samples_;
     int n_iterations_;
     bool use_prob_;
+
+    // Absent when playing out in the calling thread
+    std::unique_ptr<ThreadPool> thread_pool_;
+    std::chrono::milliseconds time_budget_{0};
+    DeterminizedMCStats stats_;
 };
 
 }  // namespace belief_sg
@@ -1,16 +1,25 @@
 #ifndef BELIEF_SG_AGENTS_DETERMINIZED_UCT_H
 #define BELIEF_SG_AGENTS_DETERMINIZED_UCT_H
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
 #include <random>
 #include <vector>
 
+#include "Belief-SG/agents/transposition_table.h"
 #include "Belief-SG/core/agent.h"
+#include "Belief-SG/core/arena.h"
 #include "Belief-SG/core/game.h"
 #include "Belief-SG/core/player_id.h"
 #include "Belief-SG/core/state.h"
 #include "Belief-SG/core/action.h"
+#include "Belief-SG/core/thread_pool.h"
 
 namespace belief_sg {
 
@@ -18,46 +27,154 @@ struct NodeUCT {
 
     struct SuccessorInfo {
         std::vector<Action> joint_action;
-        std::unique_ptr<NodeUCT> successor;
+        NodeUCT* successor;
     };
 
     struct ActionInfo {
         Action action;
         int n_visits;
         double sum_results;
+        // Playouts currently going through the action, each counted as a visit whose result, the
+        // virtual loss value, is already added to `sum_results`
+        int n_virtual_losses;
     };
 
     State state;
 
-    NodeUCT* parent_node;
-    std::optional<std::vector<Action>> parent_joint_action;
+    std::atomic<int> n_visits;
+    int n_virtual_losses = 0;
+    std::pmr::vector<std::pmr::vector<ActionInfo>> actions;
+    // With transpositions, several nodes may share a successor
+    std::pmr::vector<SuccessorInfo> successors;
+    // Guards the statistics and the successors while several threads search the tree
+    std::mutex mutex;
 
-    int n_visits;
-    std::vector<std::vector<ActionInfo>> actions;
-    std::vector<SuccessorInfo> successors;
-
-    NodeUCT(const std::shared_ptr<Game>& game, const State& state, NodeUCT* parent_node = nullptr, std::optional<std::vector<Action>> parent_joint_action = std::nullopt);
+    // The action and successor lists are allocated from `memory`
+    NodeUCT(const std::shared_ptr<Game>& game, State node_state, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    // Copy of the statistics and successors of `other`, without its pending playouts
+    NodeUCT(const NodeUCT& other, std::pmr::memory_resource* memory);
 
     bool is_fully_expanded() const;
 };
 
+// With transpositions enabled, a successor reaching the state of an existing node reuses it and
+// the search tree of each determinization becomes a DAG. At most `max_nodes` nodes are created
+// per determinization; once the graph is full, playouts start from its frontier.
+struct TranspositionOptions {
+    bool enabled = false;
+    std::size_t max_nodes = 1 << 16;
+    ReplacementPolicy replacement_policy = ReplacementPolicy::LeastVisited;
+};
+
+enum class Parallelism : std::uint8_t {
+    Root,  // Each determinization is searched by a single thread
+    Tree   // Each determinization is searched by all the threads, sharing its tree
+};
+
 class DeterminizedUCT : public Agent {
 public:
     DeterminizedUCT();
     DeterminizedUCT(int n_samples, int n_iterations, bool use_prob);
+    DeterminizedUCT(int n_samples, int n_iterations, bool use_prob, TranspositionOptions transpositions);
 
     void set_game(std::shared_ptr<Game> game) override;
     void set_player(PlayerId player) override;
+    void set_seed(std::uint64_t seed) override;
+
+    // With root parallelism, determinizations are searched independently, by up to `n_threads`
+    // threads. Each one draws its random numbers from its own generator, seeded by the agent's
+    // generator, so that the decisions do not depend on the number of threads.
+    // With tree parallelism, the threads run the playouts of one determinization at a time on
+    // its shared tree, and the decisions depend on their scheduling.
+    void set_n_threads(int n_threads, Parallelism parallelism = Parallelism::Root);
+    // Visits added to the selected actions of a shared tree until their playout is
+    // backpropagated, steering the other threads towards other actions. Each one counts as a
+    // result of `loss_value`, the minimum return of the game unless given.
+    void set_virtual_loss(int virtual_loss, std::optional<double> loss_value = std::nullopt);
+    // With a non-zero budget, each decision returns once `time_budget` has elapsed since it
+    // started, instead of after `n_iterations` playouts per determinization. The playouts are
+    // then run in rounds alternating between the determinizations, so that they all have been
+    // searched about equally whenever the time runs out.
+    void set_time_budget(std::chrono::milliseconds time_budget);
+    // With tree reuse, the trees of a decision are kept for the next one. Each tree then
+    // continues from its shallowest node consistent with the new private state, with the
+    // subgraph reachable from it, and is discarded if there is none. Trees are completed with
+    // new determinizations, and every tree only runs the playouts it lacks to reach
+    // `n_iterations` visits at its root.
+    void set_tree_reuse(bool tree_reuse);
 
     Action act(const State& private_state, const State& public_state) override;
+
+    // Transposition table statistics of the last decision, over all determinizations
+    [[nodiscard]] const TranspositionStats& transposition_stats() const;
+    // Non-root nodes of the trees at the end of the last decision
+    [[nodiscard]] std::size_t n_nodes() const;
+    // Bytes allocated from the arenas of the trees at the end of the last decision
+    [[nodiscard]] std::size_t arena_bytes() const;
+    // Playouts run during the last decision, over all determinizations
+    [[nodiscard]] int n_playouts() const;
 private:
-    void run_playout(NodeUCT* root);
+    // A node of the selected path and the index of the action taken by each of its players.
+    // Indices stay valid while other threads expand the node.
+    struct PathStep {
+        NodeUCT* node;
+        std::vector<int> action_ids;
+    };
 
-    std::vector<Action> select_joint_action(NodeUCT* node);
+    // Playouts of each determinization per round of a timed search, per searching thread
+    static constexpr int kPlayoutsPerRound = 8;
+
+    // Search tree of one determinization, with everything its search modifies. The nodes and
+    // their lists live in the arena of the tree, which frees them all at once.
+    struct SearchContext {
+        SearchContext(const TranspositionOptions& transpositions, bool shared_tree);
+        ~SearchContext();
+
+        SearchContext(const SearchContext&) = delete;
+        SearchContext& operator=(const SearchContext&) = delete;
+
+        template <typename... Args>
+        NodeUCT* make_node(Args&&... args) {
+            return std::pmr::polymorphic_allocator<NodeUCT>(&arena).new_object<NodeUCT>(std::forward<Args>(args)..., &arena);
+        }
+
+        Arena arena;
+        NodeUCT* root = nullptr;
+        // One per thread searching the tree
+        std::vector<std::mt19937> generators;
+        TranspositionTable<NodeUCT> transposition_table;
+        // Every non-root node of the determinization
+        std::vector<NodeUCT*> nodes;
+        // Set when several threads search the tree. Their states are then left untouched by
+        // the simulations, and the virtual loss is applied.
+        bool shared = false;
+        // Guards the table and the nodes of a shared tree
+        std::mutex mutex;
+        std::atomic<int> n_playouts = 0;
+    };
 
-    NodeUCT* select_and_expand(NodeUCT* node);
-    std::vector<double> simulate(NodeUCT* node);
-    void backpropagate(NodeUCT* node, const std::vector<double>& result);
+    // Keeps the trees with a node consistent with `private_state` below the last action of the
+    // agent, and makes that node their root
+    void reuse_trees(const State& private_state);
+    [[nodiscard]] NodeUCT* find_consistent_node(NodeUCT* root, const State& private_state) const;
+
+    // Runs up to `n_playouts` more playouts from the root, with every generator of the context.
+    // No playout starts after the deadline, unless the root has not been searched yet.
+    void search(NodeUCT* root, SearchContext& context, int n_playouts, std::chrono::steady_clock::time_point deadline);
+    void run_playout(NodeUCT* root, SearchContext& context, std::mt19937& generator);
+
+    // Index of the selected action of each player, to which the virtual loss is added. Requires
+    // the lock of the node.
+    std::vector<int> select_action_ids(NodeUCT* node, int virtual_loss);
+    // Result counted for each virtual loss
+    [[nodiscard]] double virtual_loss_value() const;
+
+    // Returns the node to simulate from. If the graph cannot grow there, `frontier_action` is
+    // set to the joint action selected from it, which the simulation starts with.
+    NodeUCT* select_and_expand(NodeUCT* node, std::vector<PathStep>& path, std::vector<Action>& frontier_action, SearchContext& context, std::mt19937& generator);
+    NodeUCT* new_node(State state, SearchContext& context);
+    std::vector<double> simulate(NodeUCT* node, const std::vector<Action>& frontier_action, SearchContext& context, std::mt19937& generator);
+    void backpropagate(const std::vector<PathStep>& path, NodeUCT* leaf, const std::vector<double>& result, int virtual_loss);
 
     std::mt19937 generator_;
     int n_samples_;
@@ -67,7 +184,24 @@ private:
     std::shared_ptr<Game> game_;
     PlayerId player_{0};
 
-    std::vector<std::unique_ptr<NodeUCT>> roots_;
+    TranspositionOptions transpositions_;
+    TranspositionStats transposition_stats_;
+
+    // Absent when searching in the calling thread
+    std::unique_ptr<ThreadPool> thread_pool_;
+    Parallelism parallelism_ = Parallelism::Root;
+    int virtual_loss_ = 1;
+    std::optional<double> virtual_loss_value_;
+    std::chrono::milliseconds time_budget_{0};
+    bool tree_reuse_ = false;
+
+    // Search tree of each determinization, kept between decisions with tree reuse
+    std::vector<std::unique_ptr<SearchContext>> contexts_;
+    // Action returned from the current roots
+    Action last_action_;
+    std::size_t n_nodes_ = 0;
+    std::size_t arena_bytes_ = 0;
+    int n_playouts_ = 0;
 };
 
 }  // namespace belief_sg
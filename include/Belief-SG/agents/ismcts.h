@@ -0,0 +1,122 @@
+#ifndef BELIEF_SG_AGENTS_ISMCTS_H
+#define BELIEF_SG_AGENTS_ISMCTS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include "Belief-SG/core/agent.h"
+#include "Belief-SG/core/arena.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/state.h"
+#include "Belief-SG/core/action.h"
+
+namespace belief_sg {
+
+// Information set of the searching agent. The node is reached by a sequence of joint actions,
+// and its state is the private state of the agent after them, of which every determinization
+// going through the node is a possible world.
+struct NodeISMCTS {
+
+    struct SuccessorInfo {
+        std::vector<Action> joint_action;
+        NodeISMCTS* successor;
+    };
+
+    struct ActionInfo {
+        Action action;
+        int n_visits;
+        double sum_results;
+        // Visits of the node where the action was legal in the determinization
+        int n_available;
+    };
+
+    State state;
+
+    int n_visits = 0;
+    // Actions of each current player, added as determinizations make them legal
+    std::pmr::vector<std::pmr::vector<ActionInfo>> actions;
+    // Several successors may follow the same joint action, one per observation of the agent
+    std::pmr::vector<SuccessorInfo> successors;
+
+    // The action and successor lists are allocated from `memory`
+    NodeISMCTS(State node_state, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    // Adds the actions legal in a determinization for the current player at `player_index` and
+    // counts their availability. Returns their indices.
+    std::vector<int> add_available_actions(int player_index, const std::vector<ProbAction>& legal_actions);
+    // Index of the available action with the best UCB1 score, or of the first one never visited
+    [[nodiscard]] int select_action(int player_index, const std::vector<int>& available_ids) const;
+};
+
+// Single-observer information set MCTS: a single tree over the information sets of the agent,
+// searched with a new determinization of its private state at every iteration. The actions of
+// the other players are treated as observed. The selection uses UCB1 with availability counts,
+// since the actions legal at a node depend on the determinization.
+class ISMCTS : public Agent {
+public:
+    ISMCTS();
+    ISMCTS(int n_iterations, bool use_prob);
+    ~ISMCTS() override;
+
+    void set_game(std::shared_ptr<Game> game) override;
+    void set_player(PlayerId player) override;
+    void set_seed(std::uint64_t seed) override;
+
+    // With a non-zero budget, each decision returns once `time_budget` has elapsed since it
+    // started, instead of after `n_iterations` iterations
+    void set_time_budget(std::chrono::milliseconds time_budget);
+
+    Action act(const State& private_state, const State& public_state) override;
+
+    // Non-root nodes of the tree at the end of the last decision
+    [[nodiscard]] std::size_t n_nodes() const;
+    // Iterations run during the last decision
+    [[nodiscard]] int n_playouts() const;
+private:
+    // A node of the selected path and the index of the action taken by each of its players
+    struct PathStep {
+        NodeISMCTS* node;
+        std::vector<int> action_ids;
+    };
+
+    void run_iteration(NodeISMCTS* root, const State& private_state);
+
+    // Index of the selected action of each player, among the actions legal in `state`, whose
+    // availability is counted
+    std::vector<int> select_action_ids(NodeISMCTS* node, const State& state);
+    // Successor of `node` after `joint_action` consistent with the determinization `state`, to
+    // which the joint action has already been applied. Returns nullptr if there is none yet.
+    [[nodiscard]] NodeISMCTS* find_successor(NodeISMCTS* node, const std::vector<Action>& joint_action, const State& state) const;
+    NodeISMCTS* new_successor(NodeISMCTS* node, std::vector<Action> joint_action, const State& state);
+    std::vector<double> simulate(State& state);
+    void backpropagate(const std::vector<PathStep>& path, NodeISMCTS* leaf, const std::vector<double>& result);
+
+    // Destroys the nodes and gives their memory back
+    void clear_tree();
+
+    std::mt19937 generator_;
+    int n_iterations_;
+    bool use_prob_;
+
+    std::shared_ptr<Game> game_;
+    PlayerId player_{0};
+
+    std::chrono::milliseconds time_budget_{0};
+
+    Arena arena_;
+    NodeISMCTS* root_ = nullptr;
+    // Every non-root node of the tree
+    std::vector<NodeISMCTS*> nodes_;
+    std::size_t n_nodes_ = 0;
+    int n_playouts_ = 0;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_AGENTS_ISMCTS_H
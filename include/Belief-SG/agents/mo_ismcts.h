@@ -0,0 +1,90 @@
+#ifndef BELIEF_SG_AGENTS_MO_ISMCTS_H
+#define BELIEF_SG_AGENTS_MO_ISMCTS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Belief-SG/agents/ismcts.h"
+#include "Belief-SG/core/agent.h"
+#include "Belief-SG/core/arena.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/state.h"
+#include "Belief-SG/core/action.h"
+
+namespace belief_sg {
+
+// Multiple-observer information set MCTS: one tree per player, over the information sets of that
+// player. The tree of the agent starts from its private state, the trees of the other players
+// from the public state seen from their point of view. Every iteration descends all the trees in
+// lock step with a new determinization: each player selects its action in its own tree, and
+// each tree follows the private transition of its player. A joint action that a player cannot
+// tell from another one thus leads to the same node of its tree.
+class MOISMCTS : public Agent {
+public:
+    MOISMCTS();
+    MOISMCTS(int n_iterations, bool use_prob);
+    ~MOISMCTS() override;
+
+    void set_game(std::shared_ptr<Game> game) override;
+    void set_player(PlayerId player) override;
+    void set_seed(std::uint64_t seed) override;
+
+    // With a non-zero budget, each decision returns once `time_budget` has elapsed since it
+    // started, instead of after `n_iterations` iterations
+    void set_time_budget(std::chrono::milliseconds time_budget);
+
+    Action act(const State& private_state, const State& public_state) override;
+
+    // Non-root nodes of all the trees at the end of the last decision
+    [[nodiscard]] std::size_t n_nodes() const;
+    // Iterations run during the last decision
+    [[nodiscard]] int n_playouts() const;
+private:
+    // A node of the path of a tree, with the index of its player among the current players and
+    // of the action it took, both -1 if the player did not act there
+    struct PathStep {
+        NodeISMCTS* node;
+        int player_index;
+        int action_id;
+    };
+
+    void run_iteration(const State& private_state);
+
+    // Successor of `node` after `joint_action` consistent with the determinization `state`, to
+    // which the joint action has already been applied. A new private transition of the player
+    // reaching the state of an existing successor is recorded as another edge to it. Returns
+    // nullptr if the transition leads to a new information set, which is then stored in
+    // `new_state`.
+    NodeISMCTS* find_successor(NodeISMCTS* node, const std::vector<Action>& joint_action, const State& state, State& new_state);
+    NodeISMCTS* new_node(State state);
+    std::vector<double> simulate(State& state);
+
+    // Destroys the nodes and gives their memory back
+    void clear_trees();
+
+    std::mt19937 generator_;
+    int n_iterations_;
+    bool use_prob_;
+
+    std::shared_ptr<Game> game_;
+    PlayerId player_{0};
+
+    std::chrono::milliseconds time_budget_{0};
+
+    Arena arena_;
+    // Root of the tree of each player
+    std::vector<NodeISMCTS*> roots_;
+    // Every non-root node of the trees
+    std::vector<NodeISMCTS*> nodes_;
+    std::size_t n_nodes_ = 0;
+    int n_playouts_ = 0;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_AGENTS_MO_ISMCTS_H
@@ -1,6 +1,7 @@
 #ifndef BELIEF_SG_AGENTS_RANDOM_AGENT_H
 #define BELIEF_SG_AGENTS_RANDOM_AGENT_H
 
+#include <cstdint>
 #include <memory>
 #include <random>
 
@@ -18,6 +19,7 @@ public:
 
     void set_game(std::shared_ptr<Game> game) override;
     void set_player(PlayerId player) override;
+    void set_seed(std::uint64_t seed) override;
     Action act(const State& private_state, const State& public_state) override;
 
 private:
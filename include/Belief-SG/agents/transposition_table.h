@@ -0,0 +1,117 @@
+#ifndef BELIEF_SG_AGENTS_TRANSPOSITION_TABLE_H
+#define BELIEF_SG_AGENTS_TRANSPOSITION_TABLE_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Belief-SG/core/state.h"
+
+namespace belief_sg {
+
+enum class ReplacementPolicy : std::uint8_t {
+    Oldest,       // A new node evicts the entry of its bucket stored first
+    LeastVisited  // A new node evicts the entry of its bucket whose node has the fewest visits
+};
+
+struct TranspositionStats {
+    std::size_t lookups = 0;
+    std::size_t hits = 0;
+    std::size_t stores = 0;
+    std::size_t replacements = 0;
+
+    TranspositionStats& operator+=(const TranspositionStats& other) {
+        lookups += other.lookups;
+        hits += other.hits;
+        stores += other.stores;
+        replacements += other.replacements;
+        return *this;
+    }
+
+    [[nodiscard]] double hit_rate() const {
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
+
+// Fixed-size index from states to search nodes, which own their `State state` and `int n_visits`.
+// Entries are grouped in buckets selected by the state hash; a full bucket makes room according
+// to the replacement policy. The table does not own the nodes, an evicted node simply stops
+// being found.
+template <typename Node>
+class TranspositionTable {
+public:
+    TranspositionTable(std::size_t capacity, ReplacementPolicy policy)
+            : n_buckets_(std::bit_ceil((capacity + kBucketSize - 1) / kBucketSize)),
+              entries_(n_buckets_ * kBucketSize),
+              policy_(policy) {}
+
+    // Node whose state equals `state`, or nullptr
+    [[nodiscard]] Node* find(const State& state) {
+        stats_.lookups++;
+        const std::uint64_t hash = state.hash();
+        for (Entry* entry = bucket(hash); entry != bucket(hash) + kBucketSize; entry++) {
+            if (entry->node != nullptr && entry->hash == hash && entry->node->state == state) {
+                stats_.hits++;
+                return entry->node;
+            }
+        }
+        return nullptr;
+    }
+
+    void store(Node* node) {
+        const std::uint64_t hash = node->state.hash();
+        Entry* victim = bucket(hash);
+        for (Entry* entry = bucket(hash); entry != bucket(hash) + kBucketSize; entry++) {
+            if (entry->node == nullptr) {
+                victim = entry;
+                break;
+            }
+            const bool better_victim = policy_ == ReplacementPolicy::Oldest
+                ? entry->stamp < victim->stamp
+                : entry->node->n_visits < victim->node->n_visits;
+            if (better_victim) {
+                victim = entry;
+            }
+        }
+        if (victim->node != nullptr) {
+            stats_.replacements++;
+        }
+        *victim = {.hash = hash, .node = node, .stamp = clock_++};
+        stats_.stores++;
+    }
+
+    void clear() {
+        entries_.assign(entries_.size(), Entry{});
+    }
+
+    [[nodiscard]] const TranspositionStats& stats() const {
+        return stats_;
+    }
+    void reset_stats() {
+        stats_ = {};
+    }
+
+private:
+    static constexpr std::size_t kBucketSize = 4;
+
+    struct Entry {
+        std::uint64_t hash = 0;
+        Node* node = nullptr;
+        std::uint64_t stamp = 0;
+    };
+
+    [[nodiscard]] Entry* bucket(std::uint64_t hash) {
+        return entries_.data() + (hash & (n_buckets_ - 1)) * kBucketSize;
+    }
+
+    std::size_t n_buckets_;
+    std::vector<Entry> entries_;
+    ReplacementPolicy policy_;
+    std::uint64_t clock_ = 0;
+    TranspositionStats stats_;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_AGENTS_TRANSPOSITION_TABLE_H
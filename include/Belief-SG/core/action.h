@@ -1,9 +1,11 @@
 #ifndef BELIEF_SG_CORE_ACTION_H
 #define BELIEF_SG_CORE_ACTION_H
 
+#include <cstddef>
 #include <memory>
 #include <vector>
 
+#include "Belief-SG/core/observation.h"
 #include "Belief-SG/core/prob_transition.h"
 #include "Belief-SG/core/state.h"
 #include "Belief-SG/core/move.h"
@@ -23,9 +25,16 @@ public:
     [[nodiscard]] bool operator==(const Action& other) const;
 
     [[nodiscard]] std::vector<ProbTransition> apply(const State& state) const;
+    // The transitions of `apply`, in the same order, computed as they are asked for
+    [[nodiscard]] TransitionStream transitions(const State& state) const;
     void apply_inplace(State& state, std::mt19937& generator) const;
+    void apply_inplace_observed(State& state, std::mt19937& generator, Observation& observation) const;
+    void apply_observation(State& state, const Observation& observation, std::size_t& draw_id) const;
 
 private:
+    // Transitions of the moves from `move_id` on, the previous ones having led to `state`
+    [[nodiscard]] TransitionStream transitions_from(State state, std::size_t move_id, double probability) const;
+
     std::vector<std::unique_ptr<Move>> moves_;
 };
 
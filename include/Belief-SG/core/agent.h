@@ -1,6 +1,7 @@
 #ifndef BELIEF_SG_CORE_AGENT_H
 #define BELIEF_SG_CORE_AGENT_H
 
+#include <cstdint>
 #include <memory>
 
 #include "Belief-SG/core/game.h"
@@ -15,6 +16,9 @@ public:
     virtual ~Agent() = default;
     virtual void set_game(std::shared_ptr<Game> game) = 0;
     virtual void set_player(PlayerId player) = 0;
+    // Seeds the random choices of the agent, so that its decisions can be played again. Agents
+    // without random choices ignore it.
+    virtual void set_seed(std::uint64_t /*seed*/) {}
     virtual Action act(const State& private_state, const State& public_state) = 0;
 };
 
@@ -0,0 +1,42 @@
+#ifndef BELIEF_SG_CORE_ALIGNED_ALLOCATOR_H
+#define BELIEF_SG_CORE_ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+
+namespace belief_sg {
+
+// Standard allocator returning storage aligned on `Alignment` bytes (a cache line by default),
+// so that numeric buffers start on a boundary usable by vector loads.
+template <typename T, std::size_t Alignment = 64>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>& /*other*/) noexcept {}
+
+    [[nodiscard]] T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* pointer, std::size_t /*n*/) noexcept {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>& /*other*/) const noexcept {
+        return true;
+    }
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_ALIGNED_ALLOCATOR_H
@@ -0,0 +1,52 @@
+#ifndef BELIEF_SG_CORE_ARENA_H
+#define BELIEF_SG_CORE_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace belief_sg {
+
+// Memory resource handing out consecutive slices of large blocks. Deallocation does nothing, all
+// the memory is given back at once when the arena is released or destroyed. Objects living in
+// the arena must still be destroyed by their owner if their destructor has effects.
+class Arena : public std::pmr::memory_resource {
+public:
+    // A synchronized arena may be allocated from by several threads at once
+    explicit Arena(bool synchronized = false, std::size_t block_size = 64 * 1024);
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void release();
+
+    // Bytes handed out since the last release, alignment padding included
+    [[nodiscard]] std::size_t bytes_used() const;
+    // Bytes of the blocks obtained from the system
+    [[nodiscard]] std::size_t bytes_reserved() const;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    struct Block {
+        std::byte* data;
+        std::size_t size;
+    };
+
+    bool synchronized_;
+    std::size_t block_size_;
+    std::mutex mutex_;
+    std::vector<Block> blocks_;
+    std::byte* current_ = nullptr;
+    std::byte* end_ = nullptr;
+    std::size_t bytes_used_ = 0;
+    std::size_t bytes_reserved_ = 0;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_ARENA_H
@@ -0,0 +1,49 @@
+#ifndef BELIEF_SG_CORE_BELIEF_PROPAGATION_KERNELS_H
+#define BELIEF_SG_CORE_BELIEF_PROPAGATION_KERNELS_H
+
+#include <cstdint>
+
+namespace belief_sg {
+
+enum class SimdLevel : std::uint8_t {
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+// Row primitives used by BeliefPropagation. A value takes part in a masked operation only if
+// its entry in `mask` is strictly positive, which mirrors the `marginal > 0` tests of the
+// message updates.
+struct BeliefPropagationKernels {
+    SimdLevel level;
+
+    // Returns sum(values[i]) over the unmasked entries
+    double (*masked_sum)(const double* values, const double* mask, int n);
+    // Returns sum(x[i] * y[i])
+    double (*dot)(const double* x, const double* y, int n);
+    // out[i] = a * x[i] + b * y[i]
+    void (*axpby)(double a, const double* x, double b, const double* y, double* out, int n);
+    // out[i] = values[i] over the unmasked entries
+    void (*masked_copy)(double* out, const double* values, const double* mask, int n);
+    // out[i] *= factors[i] over the unmasked entries
+    void (*masked_multiply)(double* out, const double* factors, const double* mask, int n);
+    // out[i] = damping * numerators[i] / denominators[i] + (1 - damping) * out[i] over the unmasked entries,
+    // a null denominator giving a null ratio
+    void (*masked_damped_divide)(double* out, const double* numerators, const double* denominators, const double* mask, double damping, int n);
+    // out[i] /= sum(out)
+    void (*normalize)(double* out, int n);
+};
+
+// SIMD level used by belief propagation on the running CPU: AVX2 when available, otherwise
+// scalar. The BELIEF_SG_SIMD environment variable ("scalar", "avx2" or "avx512") overrides
+// the choice within what the CPU supports, which is useful to compare kernels.
+[[nodiscard]] SimdLevel detected_simd_level();
+
+[[nodiscard]] const BeliefPropagationKernels& belief_propagation_kernels(SimdLevel level);
+
+// Kernels of the detected level, resolved once.
+[[nodiscard]] const BeliefPropagationKernels& belief_propagation_kernels();
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_BELIEF_PROPAGATION_KERNELS_H
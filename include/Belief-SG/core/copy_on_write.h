@@ -0,0 +1,48 @@
+#ifndef BELIEF_SG_CORE_COPY_ON_WRITE_H
+#define BELIEF_SG_CORE_COPY_ON_WRITE_H
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace belief_sg {
+
+// Value shared between the copies of a handle until one of them modifies it. Copying a handle
+// only copies a pointer; `write` first clones the value if another handle still refers to it.
+// Handles sharing a value may be used from different threads, as long as each handle is.
+template <typename T>
+class CopyOnWrite {
+public:
+    CopyOnWrite() : value_(std::make_shared<T>()) {}
+
+    template <typename... Args>
+    explicit CopyOnWrite(std::in_place_t /*tag*/, Args&&... args) : value_(std::make_shared<T>(std::forward<Args>(args)...)) {}
+
+    [[nodiscard]] const T& operator*() const {
+        return *value_;
+    }
+    [[nodiscard]] const T* operator->() const {
+        return value_.get();
+    }
+
+    [[nodiscard]] T& write() {
+        if (value_.use_count() > 1) {
+            value_ = std::make_shared<T>(std::as_const(*value_));
+        } else {
+            // Orders the reads made through handles released by other threads before our writes
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *value_;
+    }
+
+    [[nodiscard]] bool shares_with(const CopyOnWrite& other) const {
+        return value_ == other.value_;
+    }
+
+private:
+    std::shared_ptr<T> value_;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_COPY_ON_WRITE_H
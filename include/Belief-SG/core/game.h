@@ -1,10 +1,13 @@
 #ifndef BELIEF_SG_CORE_GAME_H
 #define BELIEF_SG_CORE_GAME_H
 
+#include <cstddef>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <random>
 
+#include "Belief-SG/core/observation.h"
 #include "Belief-SG/core/play_graph.h"
 #include "Belief-SG/core/player_id.h"
 #include "Belief-SG/core/point_of_view.h"
@@ -28,10 +31,28 @@ public:
     [[nodiscard]] virtual std::vector<ProbAction> legal_actions(const State& state, PlayerId player_id) const = 0;
 
     [[nodiscard]] virtual std::vector<ProbTransition> apply_joint_action(const State& state, const std::vector<Action>& joint_action) const;
+    // The transitions of `apply_joint_action`, in the same order, computed as they are asked for.
+    // `joint_action` must outlive the stream. A game overriding one of the two overrides both.
+    [[nodiscard]] virtual TransitionStream joint_action_transitions(const State& state, const std::vector<Action>& joint_action) const;
+    // First transition of `state` after `joint_action` consistent with `world_state`, which is how
+    // the manager updates the private and public states. Nothing if there is none.
+    [[nodiscard]] std::optional<State> consistent_transition(const State& state, const std::vector<Action>& joint_action, const State& world_state) const;
     virtual void apply_joint_action_inplace(State& state, const std::vector<Action>& joint_action, std::mt19937& generator) const;
+    // Applies the joint action in place to the world state, as `apply_joint_action_inplace`, and
+    // returns what it revealed
+    [[nodiscard]] virtual Observation apply_joint_action_observed(State& world_state, const std::vector<Action>& joint_action, std::mt19937& generator) const;
+    // Updates a private or public state after the joint action that led to `observation` in the
+    // world. The result is the transition consistent with the new world state, found without
+    // enumerating the other transitions.
+    virtual void apply_observation(State& state, const std::vector<Action>& joint_action, const Observation& observation) const;
 
     [[nodiscard]] virtual bool is_terminal(const State& state) const = 0;
     [[nodiscard]] virtual std::vector<double> returns(const State& state) const = 0;
+    // Lowest return any player can get, which searches use as a pessimistic result
+    [[nodiscard]] virtual double min_return() const = 0;
+private:
+    // Transitions of the actions from `action_id` on, the previous ones having led to `state`
+    [[nodiscard]] TransitionStream joint_action_transitions_from(State state, const std::vector<Action>& joint_action, std::size_t action_id, double probability) const;
 };
 
 }  // namespace belief_sg
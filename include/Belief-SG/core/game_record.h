@@ -0,0 +1,87 @@
+#ifndef BELIEF_SG_CORE_GAME_RECORD_H
+#define BELIEF_SG_CORE_GAME_RECORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Belief-SG/core/action.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/observation.h"
+#include "Belief-SG/core/player_id.h"
+
+namespace belief_sg {
+
+// Trajectory of a match played by a `Manager`
+struct GameRecord {
+    struct Step {
+        // Current players of the world state, chance included
+        std::vector<PlayerId> players;
+        // Index of the action of each current player among its legal actions in the world state
+        std::vector<int> action_ids;
+        // Returns of the world state after the step
+        std::vector<double> returns;
+        // What the step revealed, only kept if the record has observations
+        Observation observation;
+    };
+
+    // Name of the game
+    std::string game;
+    // Seed of the manager
+    std::uint64_t seed = 0;
+    int n_players = 0;
+    bool has_observations = false;
+    std::vector<Step> steps;
+};
+
+// Joint actions of a record, found again by playing it on `game` from the initial world state. The
+// world follows the recorded observations, or else chance is drawn again from the seed of the
+// record as the manager drew it.
+[[nodiscard]] std::vector<std::vector<Action>> record_joint_actions(const Game& game, const GameRecord& record);
+
+// Binary record files are a header followed by records, each one prefixed by its size. Actions are
+// stored as indices among the legal actions, integers as variable-length integers, returns only
+// when they change, and each record lists the distinct piece values of its observations once.
+// Records are appended whole, by any number of threads, so a file stays readable while it grows.
+class GameRecordWriter {
+public:
+    // Appends to the file at `path`, which is created if it does not exist. An existing file must
+    // be a record file, and an incomplete record at its end is cut off first.
+    explicit GameRecordWriter(const std::string& path);
+
+    GameRecordWriter(const GameRecordWriter&) = delete;
+    GameRecordWriter& operator=(const GameRecordWriter&) = delete;
+
+    void write(const GameRecord& record);
+    void flush();
+private:
+    std::mutex mutex_;
+    std::ofstream file_;
+};
+
+// Random access to the records of a file, mapped in memory. The file is indexed once by skipping
+// from a size prefix to the next, and each record is only decoded when asked for. An incomplete
+// record at the end of the file, left by an interrupted writer, is ignored.
+class GameRecordReader {
+public:
+    explicit GameRecordReader(const std::string& path);
+    ~GameRecordReader();
+
+    GameRecordReader(const GameRecordReader&) = delete;
+    GameRecordReader& operator=(const GameRecordReader&) = delete;
+
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] GameRecord record(std::size_t record_id) const;
+private:
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    // Offset of the size prefix of each complete record
+    std::vector<std::size_t> offsets_;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_GAME_RECORD_H
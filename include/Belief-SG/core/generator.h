@@ -0,0 +1,121 @@
+#ifndef BELIEF_SG_CORE_GENERATOR_H
+#define BELIEF_SG_CORE_GENERATOR_H
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace belief_sg {
+
+// Values produced one at a time by a coroutine, as the range is iterated over. Nothing runs
+// before the first value is asked for, and leaving the iteration early destroys the coroutine
+// without computing the remaining values. A generator can only be iterated over once.
+// The arguments that the coroutine takes by reference must outlive the generator. GCC 12 destroys
+// some temporaries of a `co_yield` expression twice, so values are yielded from named variables.
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+        std::suspend_always yield_value(T yielded) {
+            value = std::move(yielded);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+    };
+
+    class Iterator {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        explicit Iterator(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+        T& operator*() const {
+            return *handle_.promise().value;
+        }
+        Iterator& operator++() {
+            resume(handle_);
+            return *this;
+        }
+        void operator++(int) {
+            ++*this;
+        }
+        bool operator==(std::default_sentinel_t /*end*/) const {
+            return handle_.done();
+        }
+    private:
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    explicit Generator(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        destroy();
+    }
+
+    Iterator begin() {
+        resume(handle_);
+        return Iterator(handle_);
+    }
+    std::default_sentinel_t end() const {
+        return {};
+    }
+
+    // Computes all the remaining values
+    [[nodiscard]] std::vector<T> to_vector() {
+        std::vector<T> values;
+        for (T& value : *this) {
+            values.push_back(std::move(value));
+        }
+        return values;
+    }
+private:
+    static void resume(std::coroutine_handle<promise_type> handle) {
+        handle.promise().value.reset();
+        handle.resume();
+        if (handle.promise().error) {
+            std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+        }
+    }
+
+    void destroy() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_GENERATOR_H
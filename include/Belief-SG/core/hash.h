@@ -0,0 +1,25 @@
+#ifndef BELIEF_SG_CORE_HASH_H
+#define BELIEF_SG_CORE_HASH_H
+
+#include <cstdint>
+
+namespace belief_sg {
+
+// Finalizer of SplitMix64, a bijection of 64-bit words in which every input bit affects every
+// output bit. Keys derived from it behave like the random tables of Zobrist hashing without
+// having to store them.
+[[nodiscard]] constexpr std::uint64_t hash_mix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Order-dependent combination of a running hash with a new word
+[[nodiscard]] constexpr std::uint64_t hash_combine(std::uint64_t seed, std::uint64_t value) {
+    return hash_mix(seed ^ hash_mix(value));
+}
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_HASH_H
@@ -1,11 +1,15 @@
 #ifndef BELIEF_SG_CORE_MANAGER_H
 #define BELIEF_SG_CORE_MANAGER_H
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <random>
 #include <vector>
 
+#include "Belief-SG/core/action.h"
 #include "Belief-SG/core/game.h"
+#include "Belief-SG/core/game_record.h"
 #include "Belief-SG/core/agent.h"
 
 namespace belief_sg {
@@ -13,9 +17,26 @@ namespace belief_sg {
 class Manager {
 public:
     Manager(std::shared_ptr<Game> game, std::vector<std::unique_ptr<Agent>> agents);
+    // Chance draws from stream 0 of `seed` and the agent of player `p` is seeded with stream
+    // `p + 1`, so that a match between agents without time budgets can be played again exactly
+    Manager(std::shared_ptr<Game> game, std::vector<std::unique_ptr<Agent>> agents, std::uint64_t seed);
 
     std::vector<double> play(bool verbose = false);
 
+    // Seed of the match, drawn from `std::random_device` unless given
+    [[nodiscard]] std::uint64_t seed() const;
+    // Joint actions applied by the last call to `play`
+    [[nodiscard]] int num_steps() const;
+    // Joint actions of the last call to `play`, one per step
+    [[nodiscard]] const std::vector<std::vector<Action>>& history() const;
+
+    // Replay mode: `play` checks every joint action against `history`, recorded from a match with
+    // the same seed and agents, and throws at the first step where the match diverges from it
+    void set_replay(std::vector<std::vector<Action>> history);
+    // Appends the record of each played match to `writer`, with what each step revealed if
+    // `with_observations`
+    void set_record_writer(std::shared_ptr<GameRecordWriter> writer, bool with_observations = false);
+
 private:
     std::shared_ptr<Game> game_;
     std::vector<std::unique_ptr<Agent>> agents_;
@@ -24,7 +45,13 @@ private:
     std::vector<State> private_states_;
     State public_state_;
 
+    std::uint64_t seed_;
     std::mt19937 generator_;
+    int n_steps_ = 0;
+    std::vector<std::vector<Action>> history_;
+    std::optional<std::vector<std::vector<Action>>> replay_;
+    std::shared_ptr<GameRecordWriter> record_writer_;
+    bool record_observations_ = false;
 };
 
 }  // namespace belief_sg
@@ -1,9 +1,12 @@
 #ifndef BELIEF_SG_CORE_MOVE_H
 #define BELIEF_SG_CORE_MOVE_H
 
+#include <cstddef>
 #include <memory>
+#include <random>
 #include <vector>
 
+#include "Belief-SG/core/observation.h"
 #include "Belief-SG/core/prob_transition.h"
 #include "Belief-SG/core/state.h"
 
@@ -14,7 +17,17 @@ public:
     virtual ~Move() = default;
 
     [[nodiscard]] virtual std::vector<ProbTransition> apply(const State& state) const = 0;
+    // The transitions of `apply`, in the same order. Moves with many transitions compute them
+    // lazily; by default they are all computed on the first access.
+    [[nodiscard]] virtual TransitionStream transitions(const State& state) const;
     virtual void apply_inplace(State& state, std::mt19937& generator) const = 0;
+    // Applies the move in place to the world state, as `apply_inplace`, adding the values it draws
+    // for the pieces to `observation`. Moves that draw values override it.
+    virtual void apply_inplace_observed(State& state, std::mt19937& generator, Observation& observation) const;
+    // Applies the move in place to another point of view with the values that the world drew,
+    // from `observation.draws[draw_id]` on. Only the pieces seen from this point of view are
+    // assigned. By default the move must have a single transition.
+    virtual void apply_observation(State& state, const Observation& observation, std::size_t& draw_id) const;
 
     [[nodiscard]] virtual std::unique_ptr<Move> clone() const = 0;
     bool operator==(const Move& other) const;
@@ -15,13 +15,19 @@ public:
     ~Reveal() override = default;
 
     [[nodiscard]] std::vector<ProbTransition> apply(const State& state) const override;
+    [[nodiscard]] TransitionStream transitions(const State& state) const override;
     void apply_inplace(State& state, std::mt19937& generator) const override;
+    void apply_inplace_observed(State& state, std::mt19937& generator, Observation& observation) const override;
+    void apply_observation(State& state, const Observation& observation, std::size_t& draw_id) const override;
 
     [[nodiscard]] std::unique_ptr<Move> clone() const override;
 private:
     Position from_;
     std::vector<PlayerId> observers_;
 
+    // Transitions assigning a value to each piece of the cell from `stack_id` on
+    [[nodiscard]] TransitionStream assign_values(State state, int stack_id, int n_pieces, double probability) const;
+
     [[nodiscard]] bool is_equals(const Move& other) const override;
 };
 
@@ -16,6 +16,8 @@ public:
 
     [[nodiscard]] std::vector<ProbTransition> apply(const State& state) const override;
     void apply_inplace(State& state, std::mt19937& generator) const override;
+    void apply_inplace_observed(State& state, std::mt19937& generator, Observation& observation) const override;
+    void apply_observation(State& state, const Observation& observation, std::size_t& draw_id) const override;
 
     [[nodiscard]] std::unique_ptr<Move> clone() const override;
 private:
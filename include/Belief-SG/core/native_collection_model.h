@@ -0,0 +1,347 @@
+#ifndef BELIEF_SG_CORE_NATIVE_COLLECTION_MODEL_H
+#define BELIEF_SG_CORE_NATIVE_COLLECTION_MODEL_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Belief-SG/core/hash.h"
+
+namespace belief_sg {
+
+// Constraint model of a collection without Gecode. Each piece is a variable whose domain, a set
+// of at most 64 value indices, is stored as a bitset. `add_counts` posts the global cardinality
+// constraint fixing how many pieces take each value.
+//
+// Propagation maintains an assignment of the pieces to the values respecting the counts and
+// removes every value that appears in no such assignment (Regin's flow-based filtering). Since
+// the counts are exact and sum to the number of pieces, the residual graph has no free vertex
+// and an unused edge is supported iff both ends lie in the same strongly connected component.
+// This makes the model domain consistent, so a successful propagation proves a solution exists.
+class NativeCollectionModel {
+public:
+    NativeCollectionModel(int n_pieces, int n_values);
+
+    [[nodiscard]] std::unique_ptr<NativeCollectionModel> clone_model() const;
+
+    // Propagates the pending domain changes, returns false if the model has no solution
+    bool propagate();
+    [[nodiscard]] bool is_solved();
+    [[nodiscard]] bool has_solution();
+
+    [[nodiscard]] bool is_assigned(int id) const;
+    [[nodiscard]] int get_value(int id) const;
+    [[nodiscard]] std::vector<int> get_values(int id) const;
+    [[nodiscard]] std::vector<bool> get_domain(int id) const;
+    [[nodiscard]] std::vector<std::vector<bool>> get_domains() const;
+    // Hash of the domain of a piece, to be taken once the model is propagated
+    [[nodiscard]] std::uint64_t domain_hash(int id) const;
+
+    void remove_value(int id, int value);
+    void assign_value(int id, int value);
+
+    void add_counts(std::vector<int> counts);
+
+    void print() const;
+
+private:
+    static constexpr int kMaxValues = 64;
+    static constexpr int kUnmatched = -1;
+
+    [[nodiscard]] static std::uint64_t bit(int value) {
+        return std::uint64_t{1} << value;
+    }
+
+    void unmatch(int id);
+    bool match(int id);
+    void filter();
+
+    int n_pieces_;
+    int n_values_;
+
+    std::vector<std::uint64_t> domains_;
+    std::vector<int> counts_;
+    // Current assignment of the pieces and number of pieces assigned to each value
+    std::vector<int> matching_;
+    std::vector<int> loads_;
+
+    bool failed_ = false;
+    bool changed_ = false;
+};
+
+inline NativeCollectionModel::NativeCollectionModel(int n_pieces, int n_values)
+        : n_pieces_(n_pieces),
+          n_values_(n_values),
+          domains_(n_pieces, n_values >= kMaxValues ? ~std::uint64_t{0} : bit(n_values) - 1),
+          matching_(n_pieces, kUnmatched),
+          loads_(n_values, 0) {
+    if (n_values > kMaxValues) {
+        throw std::invalid_argument("A collection model supports at most 64 values, got " + std::to_string(n_values));
+    }
+}
+
+inline std::unique_ptr<NativeCollectionModel> NativeCollectionModel::clone_model() const {
+    return std::make_unique<NativeCollectionModel>(*this);
+}
+
+inline bool NativeCollectionModel::propagate() {
+    if (failed_) {
+        return false;
+    }
+    // A propagated model is left untouched, so that it can be shared between threads
+    if (!changed_) {
+        return true;
+    }
+    if (counts_.empty()) {
+        changed_ = false;
+        return true;
+    }
+    for (int id = 0; id < n_pieces_; id++) {
+        if (matching_[id] == kUnmatched && !match(id)) {
+            failed_ = true;
+            return false;
+        }
+    }
+    filter();
+    changed_ = false;
+    return true;
+}
+
+inline bool NativeCollectionModel::is_solved() {
+    if (!propagate()) {
+        return false;
+    }
+    for (std::uint64_t domain : domains_) {
+        if (std::popcount(domain) != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool NativeCollectionModel::has_solution() {
+    return propagate();
+}
+
+inline bool NativeCollectionModel::is_assigned(int id) const {
+    return std::popcount(domains_[id]) == 1;
+}
+
+inline int NativeCollectionModel::get_value(int id) const {
+    return std::countr_zero(domains_[id]);
+}
+
+inline std::vector<int> NativeCollectionModel::get_values(int id) const {
+    std::vector<int> values;
+    values.reserve(std::popcount(domains_[id]));
+    for (std::uint64_t domain = domains_[id]; domain != 0; domain &= domain - 1) {
+        values.push_back(std::countr_zero(domain));
+    }
+    return values;
+}
+
+inline std::vector<bool> NativeCollectionModel::get_domain(int id) const {
+    std::vector<bool> domain(n_values_, false);
+    for (int value = 0; value < n_values_; value++) {
+        domain[value] = (domains_[id] & bit(value)) != 0;
+    }
+    return domain;
+}
+
+inline std::vector<std::vector<bool>> NativeCollectionModel::get_domains() const {
+    std::vector<std::vector<bool>> domains;
+    domains.reserve(n_pieces_);
+    for (int id = 0; id < n_pieces_; id++) {
+        domains.push_back(get_domain(id));
+    }
+    return domains;
+}
+
+inline std::uint64_t NativeCollectionModel::domain_hash(int id) const {
+    return hash_mix(domains_[id]);
+}
+
+inline void NativeCollectionModel::remove_value(int id, int value) {
+    if ((domains_[id] & bit(value)) == 0) {
+        return;
+    }
+    domains_[id] &= ~bit(value);
+    if (matching_[id] == value) {
+        unmatch(id);
+    }
+    failed_ = failed_ || domains_[id] == 0;
+    changed_ = true;
+}
+
+inline void NativeCollectionModel::assign_value(int id, int value) {
+    if (value < 0 || value >= n_values_ || (domains_[id] & bit(value)) == 0) {
+        failed_ = true;
+        return;
+    }
+    if (domains_[id] == bit(value)) {
+        return;
+    }
+    domains_[id] = bit(value);
+    if (matching_[id] != value) {
+        unmatch(id);
+    }
+    changed_ = true;
+}
+
+inline void NativeCollectionModel::add_counts(std::vector<int> counts) {
+    if (static_cast<int>(counts.size()) != n_values_) {
+        throw std::invalid_argument("Expected one count per value");
+    }
+    counts_ = std::move(counts);
+    // Every piece takes exactly one value
+    failed_ = failed_ || std::accumulate(counts_.begin(), counts_.end(), 0) != n_pieces_;
+    changed_ = true;
+}
+
+inline void NativeCollectionModel::print() const {
+    std::cout << "{";
+    for (int id = 0; id < n_pieces_; id++) {
+        std::cout << (id == 0 ? "" : ", ");
+        if (is_assigned(id)) {
+            std::cout << get_value(id);
+            continue;
+        }
+        std::cout << "{";
+        std::vector<int> values = get_values(id);
+        for (std::size_t i = 0; i < values.size(); i++) {
+            std::cout << (i == 0 ? "" : ",") << values[i];
+        }
+        std::cout << "}";
+    }
+    std::cout << "}" << std::endl;
+}
+
+inline void NativeCollectionModel::unmatch(int id) {
+    if (matching_[id] != kUnmatched) {
+        loads_[matching_[id]]--;
+        matching_[id] = kUnmatched;
+    }
+}
+
+// Augmenting path search from an unmatched piece: breadth first over the pieces, moving from a
+// piece to a value of its domain and from a full value to the pieces currently assigned to it.
+inline bool NativeCollectionModel::match(int id) {
+    std::vector<int> value_parents(n_values_, kUnmatched);
+    std::vector<bool> reached(n_pieces_, false);
+    std::vector<int> queue = {id};
+    reached[id] = true;
+    std::uint64_t visited = 0;
+
+    for (std::size_t head = 0; head < queue.size(); head++) {
+        const int piece = queue[head];
+        for (std::uint64_t candidates = domains_[piece] & ~visited; candidates != 0; candidates &= candidates - 1) {
+            const int value = std::countr_zero(candidates);
+            visited |= bit(value);
+            value_parents[value] = piece;
+            if (loads_[value] < counts_[value]) {
+                loads_[value]++;
+                // Shift the assignments along the path back to the root
+                for (int current = value; current != kUnmatched;) {
+                    const int parent = value_parents[current];
+                    const int previous = matching_[parent];
+                    matching_[parent] = current;
+                    current = parent == id ? kUnmatched : previous;
+                }
+                return true;
+            }
+            for (int other = 0; other < n_pieces_; other++) {
+                if (matching_[other] == value && !reached[other]) {
+                    reached[other] = true;
+                    queue.push_back(other);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Strongly connected components of the residual graph (pieces point to the values of their
+// domain they are not assigned to, values point to the pieces assigned to them), computed with
+// an iterative Tarjan. Unassigned edges crossing two components are removed.
+inline void NativeCollectionModel::filter() {
+    const int n_nodes = n_pieces_ + n_values_;
+    std::vector<int> index(n_nodes, kUnmatched);
+    std::vector<int> low_link(n_nodes, 0);
+    std::vector<int> component(n_nodes, kUnmatched);
+    std::vector<bool> on_stack(n_nodes, false);
+    std::vector<int> stack;
+    stack.reserve(n_nodes);
+
+    std::vector<std::vector<int>> successors(n_nodes);
+    for (int piece = 0; piece < n_pieces_; piece++) {
+        for (std::uint64_t values = domains_[piece] & ~bit(matching_[piece]); values != 0; values &= values - 1) {
+            successors[piece].push_back(n_pieces_ + std::countr_zero(values));
+        }
+        successors[n_pieces_ + matching_[piece]].push_back(piece);
+    }
+
+    struct Frame {
+        int node;
+        std::size_t next;
+    };
+    std::vector<Frame> frames;
+    int counter = 0;
+    int n_components = 0;
+    for (int root = 0; root < n_nodes; root++) {
+        if (index[root] != kUnmatched) {
+            continue;
+        }
+        frames.push_back({root, 0});
+        while (!frames.empty()) {
+            Frame& frame = frames.back();
+            const int node = frame.node;
+            if (frame.next == 0) {
+                index[node] = low_link[node] = counter++;
+                stack.push_back(node);
+                on_stack[node] = true;
+            }
+            if (frame.next < successors[node].size()) {
+                const int successor = successors[node][frame.next++];
+                if (index[successor] == kUnmatched) {
+                    frames.push_back({successor, 0});
+                } else if (on_stack[successor]) {
+                    low_link[node] = std::min(low_link[node], index[successor]);
+                }
+                continue;
+            }
+            if (low_link[node] == index[node]) {
+                int member = kUnmatched;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    on_stack[member] = false;
+                    component[member] = n_components;
+                } while (member != node);
+                n_components++;
+            }
+            frames.pop_back();
+            if (!frames.empty()) {
+                low_link[frames.back().node] = std::min(low_link[frames.back().node], low_link[node]);
+            }
+        }
+    }
+
+    for (int piece = 0; piece < n_pieces_; piece++) {
+        for (std::uint64_t values = domains_[piece] & ~bit(matching_[piece]); values != 0; values &= values - 1) {
+            const int value = std::countr_zero(values);
+            if (component[piece] != component[n_pieces_ + value]) {
+                domains_[piece] &= ~bit(value);
+            }
+        }
+    }
+}
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_NATIVE_COLLECTION_MODEL_H
@@ -0,0 +1,20 @@
+#ifndef BELIEF_SG_CORE_OBSERVATION_H
+#define BELIEF_SG_CORE_OBSERVATION_H
+
+#include <vector>
+
+#include "Belief-SG/core/piece_value.h"
+
+namespace belief_sg {
+
+// What a joint action revealed when it was applied to the world state: the values drawn by each
+// move that assigns values to pieces, in the order of the moves, one entry per draw even when no
+// value was assigned. Everything else a move does only depends on the move, so another point of
+// view replays the joint action with these values instead of enumerating all its outcomes.
+struct Observation {
+    std::vector<std::vector<PieceValue>> draws;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_OBSERVATION_H
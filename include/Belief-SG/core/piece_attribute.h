@@ -22,6 +22,7 @@ public:
         }
         return std::get<T>(value_);
     }
+    [[nodiscard]] const AttributeValue& raw_value() const;
 
     bool operator==(const PieceAttribute& other) const = default;
 
@@ -1,6 +1,9 @@
 #ifndef BELIEF_SG_CORE_PROB_TRANSITION_H
 #define BELIEF_SG_CORE_PROB_TRANSITION_H
 
+#include <vector>
+
+#include "Belief-SG/core/generator.h"
 #include "Belief-SG/core/state.h"
 
 namespace belief_sg {
@@ -10,6 +13,15 @@ struct ProbTransition {
     double probability{};
 };
 
+// Transitions computed one at a time, so that a caller looking for one of them stops as soon as
+// it is found
+using TransitionStream = Generator<ProbTransition>;
+
+// Merges the transitions to equal states, summing their probabilities. The first transition to
+// each state keeps its place among the others. Opt-in, since a caller drawing uniformly among the
+// transitions, as the manager does for chance, would see different odds.
+void merge_duplicate_transitions(std::vector<ProbTransition>& transitions);
+
 }  // namespace belief_sg
 
 #endif  //BELIEF_SG_CORE_PROB_TRANSITION_H
@@ -0,0 +1,38 @@
+#ifndef BELIEF_SG_CORE_SEEDING_H
+#define BELIEF_SG_CORE_SEEDING_H
+
+#include <cstdint>
+#include <random>
+
+#include "Belief-SG/core/hash.h"
+
+namespace belief_sg {
+
+// Seed of the random stream `stream_id` of a component seeded with `seed`. Streams are found from
+// their number rather than drawn one after the other, so that a stream, such as the one of a
+// thread or of a determinization, does not depend on how many others were used before it.
+[[nodiscard]] constexpr std::uint64_t stream_seed(std::uint64_t seed, std::uint64_t stream_id) {
+    return hash_combine(seed, stream_id);
+}
+
+// Generator seeded with all the bits of a 64-bit seed
+[[nodiscard]] inline std::mt19937 make_generator(std::uint64_t seed) {
+    std::seed_seq sequence{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)};
+    return std::mt19937(sequence);
+}
+
+// Seed of 64 bits drawn from `generator`
+[[nodiscard]] inline std::uint64_t draw_seed(std::mt19937& generator) {
+    const std::uint64_t high = generator();
+    return (high << 32) | generator();
+}
+
+// Seed drawn from `std::random_device`, for components that are not given one
+[[nodiscard]] inline std::uint64_t random_seed() {
+    std::random_device device;
+    return (static_cast<std::uint64_t>(device()) << 32) | device();
+}
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_SEEDING_H
@@ -1,14 +1,26 @@
 #ifndef BELIEF_SG_CORE_STATE_H
 #define BELIEF_SG_CORE_STATE_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <random>
+#include <utility>
+#include <variant>
 
+#ifdef BELIEF_SG_USE_GECODE
 #include <gecode/int.hh>
 #include <gecode/search.hh>
+#endif
 
+#include "Belief-SG/core/aligned_allocator.h"
+#include "Belief-SG/core/belief_propagation_kernels.h"
+#include "Belief-SG/core/copy_on_write.h"
+#include "Belief-SG/core/native_collection_model.h"
 #include "Belief-SG/core/piece_attribute.h"
 #include "Belief-SG/core/piece_type.h"
 #include "Belief-SG/core/piece_value.h"
@@ -33,6 +45,9 @@ struct Piece {
     [[nodiscard]] double probability(const PieceValue& value) const;
 };
 
+// Both models expose the same API. The native one is used unless the library is built with
+// BELIEF_SG_USE_GECODE.
+#ifdef BELIEF_SG_USE_GECODE
 class CollectionModel : public Gecode::Space {
 protected:
     Gecode::IntVarArray pieces_;
@@ -44,10 +59,18 @@ public:
 
     Gecode::Space* copy() override;
 
+    [[nodiscard]] std::unique_ptr<CollectionModel> clone_model() const;
+
+    bool propagate();
+    [[nodiscard]] bool is_solved();
+    [[nodiscard]] bool has_solution();
+
+    [[nodiscard]] bool is_assigned(int id) const;
     [[nodiscard]] int get_value(int id) const;
     [[nodiscard]] std::vector<int> get_values(int id) const;
     [[nodiscard]] std::vector<bool> get_domain(int id) const;
     [[nodiscard]] std::vector<std::vector<bool>> get_domains() const;
+    [[nodiscard]] std::uint64_t domain_hash(int id) const;
 
     void remove_value(int id, int value);
     void assign_value(int id, int value);
@@ -56,6 +79,9 @@ public:
 
     void print() const;
 };
+#else
+using CollectionModel = NativeCollectionModel;
+#endif
 
 class BeliefPropagation {
 public:
@@ -65,49 +91,102 @@ public:
     void update_probabilities(const std::vector<std::vector<bool>>& domains);
 
     [[nodiscard]] double get_probability(int id, int value) const {
-        return probabilities_[id][value];
+        return arena_[probabilities_ + static_cast<std::size_t>(id * n_values_ + value)];
     }
 
 private:
+    // Every buffer of the factor graph lives in `arena_`, a single cache-line aligned allocation.
+    // Messages are stored as [constraint][variable][value] so that both the constraint pass and
+    // the per-constraint products of the variable pass read contiguous rows.
+    using Arena = std::vector<double, AlignedAllocator<double>>;
+
+    [[nodiscard]] double* variable_messages(int constraint_id, int variable_id) {
+        return arena_.data() + variable_messages_ + static_cast<std::size_t>((constraint_id * n_variables_ + variable_id) * n_values_);
+    }
+    [[nodiscard]] double* constraint_messages(int constraint_id, int variable_id) {
+        return arena_.data() + constraint_messages_ + static_cast<std::size_t>((constraint_id * n_variables_ + variable_id) * n_values_);
+    }
+    [[nodiscard]] double* variable_marginals(int variable_id) {
+        return arena_.data() + variable_marginals_ + static_cast<std::size_t>(variable_id * n_values_);
+    }
+    [[nodiscard]] double* domain(int variable_id) {
+        return arena_.data() + domains_ + static_cast<std::size_t>(variable_id * n_values_);
+    }
+    [[nodiscard]] double* prefix(int variable_id) {
+        return arena_.data() + prefix_ + static_cast<std::size_t>(variable_id * (max_count_ + 1));
+    }
+    [[nodiscard]] double* suffix(int variable_id) {
+        return arena_.data() + suffix_ + static_cast<std::size_t>(variable_id * (max_count_ + 1));
+    }
+
     void reset_variables_messages_and_marginals();
     void reset_constraints_messages();
 
-    void compute_constraints_messages();
+    // Restricts the converged messages of the variables whose domain shrank (flagged by an
+    // infinite residual) to their new domain. Returns false if the removed values carried too
+    // much probability mass for the previous fixed point to be a good starting point.
+    bool warm_start();
+    // Iterates until the marginals stop changing. In incremental mode, only the variables whose
+    // incoming messages changed since their last update are recomputed.
+    bool propagate(bool incremental);
+    [[nodiscard]] bool marginals_are_finite() const;
+
+    void compute_constraints_messages(bool track_residuals);
 
-    void compute_constraint_messages(int constraint_id);
-    void normalize_constraint_messages(int constraint_id);
+    void compute_constraint_messages(int constraint_id, bool track_residuals);
 
-    double compute_variables_messages_and_marginals();
+    double compute_variables_messages_and_marginals(bool incremental);
 
     double compute_variable_messages_and_marginals(int variable_id);
     void normalize_variable_messages(int variable_id);
     void normalize_variable_marginals(int variable_id);
 
     static const int n_iter_ = 100;
+    static const int n_incremental_iter_ = 2;
+    static constexpr double warm_start_max_removed_mass_ = 1e-2;
     static constexpr double epsilon_ = 1e-6;
     double damping_ = 0.5;
 
-    int n_variables_;
-    int n_values_;
-    int n_constraints_;
+    int n_variables_{};
+    int n_values_{};
+    int n_constraints_{};
+    int max_count_{};
 
     std::vector<int> counts_;
-    std::vector<int> values_;
-
-    std::vector<std::vector<std::vector<double>>> variable_messages_;
-    std::vector<std::vector<double>> variable_marginals_;
-
-    std::vector<std::vector<std::vector<double>>> constraint_messages_;
 
-    std::vector<std::vector<bool>> domains_;
-    std::vector<std::vector<double>> probabilities_;
+    // Offsets of each section in the arena
+    std::size_t variable_messages_{};
+    std::size_t constraint_messages_{};
+    std::size_t variable_marginals_{};
+    std::size_t probabilities_{};
+    std::size_t domains_{};
+    std::size_t prefix_{};
+    std::size_t suffix_{};
+    std::size_t hit_weights_{};
+    std::size_t miss_weights_{};
+    std::size_t previous_marginals_{};
+    std::size_t previous_messages_{};
+    std::size_t variable_residuals_{};
+
+    // Whether the messages in the arena are a fixed point for the current domains
+    bool converged_ = false;
+
+    Arena arena_;
+
+    const BeliefPropagationKernels* kernels_ = &belief_propagation_kernels();
 };
 
 struct CollectionWrapper {
     std::shared_ptr<const PieceType> type;
-    std::unique_ptr<CollectionModel> original_model;
+    // Never modified once built, so shared by every copy
+    std::shared_ptr<const CollectionModel> original_model;
     std::unique_ptr<CollectionModel> model;
-    BeliefPropagation rbp;
+    // Marginals are only recomputed when queried after the domains of `model` changed. Copies
+    // share the buffers until one of them has to recompute its marginals. The refresh is
+    // guarded so that a collection shared by states of different threads can be queried.
+    mutable CopyOnWrite<BeliefPropagation> rbp;
+    mutable std::atomic<bool> probabilities_outdated = false;
+    mutable std::mutex rbp_mutex;
     std::vector<std::vector<PlayerId>> observers;
 
     CollectionWrapper() = default;
@@ -118,6 +197,15 @@ struct CollectionWrapper {
     CollectionWrapper& operator=(const CollectionWrapper& other);
 
     void swap(CollectionWrapper& other) noexcept;
+
+    // Marks the marginals as stale, to be called after any change of the domains of `model`
+    void invalidate_probabilities();
+    // Marginal probability of `value` for the piece, an assigned piece skipping belief propagation
+    [[nodiscard]] double probability(int piece_id, int value) const;
+
+private:
+    // Copies `other` while its marginals are locked, as another thread may be refreshing them
+    CollectionWrapper(const CollectionWrapper& other, const std::lock_guard<std::mutex>& lock);
 };
 
 class Game;
@@ -130,13 +218,18 @@ public:
 
     [[nodiscard]] std::shared_ptr<const Game> game() const;
     [[nodiscard]] PointOfView point_of_view() const;
+    // Copy of a public state from the private point of view of `player_id`, who knows at least
+    // what is public. Pieces the player already observes keep their public domain.
+    [[nodiscard]] State private_view(PlayerId player_id) const;
 
     [[nodiscard]] const std::vector<PlayerId>& current_players() const;
     void set_current_player(PlayerId player_id);
     void set_current_players(const std::vector<PlayerId>& player_ids);
 
-    [[nodiscard]] Piece get_piece_at(const Position& position) const;
-    [[nodiscard]] std::vector<Piece> get_pieces_at(const Position& position) const;
+    // Without probabilities, the returned pieces only expose their domain (`probs` is empty) and
+    // no belief propagation is triggered.
+    [[nodiscard]] Piece get_piece_at(const Position& position, bool with_probabilities = true) const;
+    [[nodiscard]] std::vector<Piece> get_pieces_at(const Position& position, bool with_probabilities = true) const;
 
     [[nodiscard]] Variable variable(const std::string& name) const;
     void set_variable(const Variable& variable);
@@ -148,6 +241,12 @@ public:
     void remove_piece_values(const Position& from, const std::vector<PieceValue>& values);
 
     void assign_piece_value(const Position& from, const PieceValue& value);
+    // Assigns `values[i]` to the i-th piece of the cell of `from`, or `values[0]` to the piece at
+    // `from` if it has a stack id
+    void assign_piece_values(const Position& from, const std::vector<PieceValue>& values);
+    // Assigns to each piece at `from` in turn a value drawn uniformly among those it can still
+    // take, and returns them in the order of `assign_piece_values`
+    std::vector<PieceValue> draw_piece_values(const Position& from, std::mt19937& generator);
 
     bool add_observers(const Position& from, const std::vector<PlayerId>& observers);
     void remove_observers(const Position& from, const std::vector<PlayerId>& observers);
@@ -159,11 +258,36 @@ public:
 
     [[nodiscard]] bool is_consistent_with(const State& other) const;
 
+    // 64-bit hash of the point of view, the current players, the variables, the content of
+    // every cell stack (collection, domain and observers of each piece) and the pieces of each
+    // collection removed from the board. It is updated by the mutators and equal states have equal
+    // hashes.
+    [[nodiscard]] std::uint64_t hash() const;
+    // Hash recomputed from every component, which `hash` must always equal
+    [[nodiscard]] std::uint64_t compute_hash() const;
+    // Compares the same components as the hash: pieces are identified by their collection,
+    // domain and observers, and the pieces of a collection removed from the board are compared
+    // whatever their order, since which hidden piece was removed is not observed. Both states are
+    // assumed to come from the same game.
+    bool operator==(const State& other) const;
+
     [[nodiscard]] bool is_determined() const;
 
-    double determinize(std::mt19937& generator);
+    // Assigns a value drawn uniformly from its domain to each unassigned piece, and returns the
+    // probability of the assignment. Without probability, 1.0 is returned and no belief
+    // propagation is triggered.
+    double determinize(std::mt19937& generator, bool with_probability = true);
     double determinize_with_marginals(std::mt19937& generator);
 
+    // Undo log: after a checkpoint, the previous version of every modified component is recorded
+    // once, at its first modification, so that `rollback` can restore the state in O(changes)
+    // instead of copying it beforehand.
+    // Checkpoints nest; rolling back to the first one stops the recording. A copied state starts
+    // without checkpoints.
+    using Checkpoint = std::size_t;
+    [[nodiscard]] Checkpoint checkpoint();
+    void rollback(Checkpoint checkpoint);
+
     [[nodiscard]] std::string to_string() const;
 private:
 
@@ -172,20 +296,108 @@ private:
     struct PieceIds {
         int collection_id;
         int piece_id;
+
+        bool operator==(const PieceIds& other) const = default;
     };
 
     PieceIds pop_piece_id_from_cell(const Position& position);
     void put_piece_id_in_cell(const Position& position, PieceIds piece_id);
 
+    // Cell of a piece removed from the board
+    static constexpr int kOffBoard = -1;
+    void set_piece_cell(PieceIds piece_ids, int cell_id);
+
+    using Cell = std::vector<PieceIds>;
+
+    // Components are shared with the copies of the state and only cloned when modified, through
+    // the `edit_*` accessors which also record their previous version in the trail the first time
+    // they are modified after the last checkpoint
+    Cell& edit_cell(int cell_id);
+    CollectionWrapper& edit_collection(int collection_id);
+    std::vector<Variable>& edit_variables();
+
+    // Checkpoints are numbered from 1 in the order in which they are made, 0 standing for none
+    using Stamp = std::uint64_t;
+
+    struct HashChange {
+        std::uint64_t hash;
+        // Checkpoint that was current before this one
+        Stamp stamp;
+    };
+    struct CurrentPlayersChange {
+        std::vector<PlayerId> players;
+    };
+    struct CellChange {
+        int cell_id;
+        CopyOnWrite<Cell> cell;
+        Stamp stamp;
+    };
+    struct CollectionChange {
+        int collection_id;
+        CopyOnWrite<CollectionWrapper> collection;
+        Stamp stamp;
+    };
+    struct VariablesChange {
+        CopyOnWrite<std::vector<Variable>> variables;
+        Stamp stamp;
+    };
+    struct PieceCellChange {
+        PieceIds piece_ids;
+        int cell_id;
+    };
+    using TrailEntry = std::variant<HashChange, CurrentPlayersChange, CellChange, CollectionChange, VariablesChange, PieceCellChange>;
+
+    void record(TrailEntry entry);
+
+    struct Trail {
+        std::vector<TrailEntry> entries;
+        bool recording = false;
+        Stamp current = 0;
+        Stamp last = 0;
+        // Checkpoint during which each component was last recorded, so that it is only recorded
+        // once per checkpoint and then modified in place
+        std::vector<Stamp> cell_stamps;
+        std::vector<Stamp> collection_stamps;
+        Stamp variables_stamp = 0;
+
+        Trail() = default;
+        Trail(const Trail& /*other*/) {}
+        Trail& operator=(const Trail& other);
+        Trail(Trail&& other) noexcept = default;
+        Trail& operator=(Trail&& other) noexcept = default;
+        ~Trail() = default;
+    };
+
+    [[nodiscard]] std::uint64_t point_of_view_hash() const;
+    [[nodiscard]] std::uint64_t current_players_hash() const;
+    [[nodiscard]] std::uint64_t piece_hash(PieceIds piece_ids) const;
+    [[nodiscard]] std::uint64_t cell_hash(int cell_id) const;
+    // Key of the pieces of the collection removed from the board, whatever their order
+    [[nodiscard]] std::uint64_t off_board_hash(int collection_id) const;
+    // XOR of the hashes of the cells holding a piece of the collection and of its off-board key,
+    // which may all change when its model propagates. Only these cells are visited, through
+    // `piece_cells_`.
+    [[nodiscard]] std::uint64_t collection_hash(int collection_id) const;
+    // Domain and observers of each piece of the collection removed from the board, sorted
+    [[nodiscard]] std::vector<std::pair<std::vector<int>, std::vector<PlayerId>>> off_board_pieces(int collection_id) const;
+
     std::shared_ptr<const Game> game_;
     PointOfView point_of_view_;
     std::vector<PlayerId> current_players_;
 
-    std::vector<std::vector<PieceIds>> cells_;
+    std::vector<CopyOnWrite<Cell>> cells_;
+
+    std::vector<CopyOnWrite<CollectionWrapper>> collections_;
+    // Cell holding each piece of each collection, or `kOffBoard`
+    std::vector<CopyOnWrite<std::vector<int>>> piece_cells_;
+
+    CopyOnWrite<std::vector<Variable>> variables_;
 
-    std::vector<CollectionWrapper> collections_;
+    Trail trail_;
 
-    std::vector<Variable> variables_;
+    // XOR of one key per component, a key being recomputed when its component changes: the point
+    // of view, the current players, each cell stack and each variable
+    std::uint64_t hash_{};
 
     friend class StateBuilder;
 };
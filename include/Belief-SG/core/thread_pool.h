@@ -0,0 +1,61 @@
+#ifndef BELIEF_SG_CORE_THREAD_POOL_H
+#define BELIEF_SG_CORE_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace belief_sg {
+
+// Fixed set of worker threads executing batches of independent tasks. The tasks of a batch are
+// split evenly between the queues of the workers; a worker whose queue is empty steals tasks
+// from the others, so that uneven tasks still keep every worker busy.
+class ThreadPool {
+public:
+    explicit ThreadPool(int n_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    [[nodiscard]] int size() const;
+
+    // Runs task(0), ..., task(n_tasks - 1) on the workers and waits for all of them. The first
+    // exception thrown by a task is rethrown once the batch is over.
+    void parallel_for(int n_tasks, const std::function<void(int)>& task);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    void work(int worker_id);
+    // Runs a task of the worker's queue, or else one stolen from another queue. Returns false if
+    // every queue was empty.
+    bool run_task(int worker_id);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    // Guards the batch counter and the error, and signals the workers
+    std::mutex mutex_;
+    std::condition_variable batch_started_;
+    std::condition_variable batch_done_;
+    const std::function<void(int)>* task_ = nullptr;
+    std::uint64_t batch_ = 0;
+    std::atomic<int> n_pending_ = 0;
+    std::exception_ptr error_;
+    bool stopping_ = false;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_THREAD_POOL_H
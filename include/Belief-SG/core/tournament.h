@@ -0,0 +1,80 @@
+#ifndef BELIEF_SG_CORE_TOURNAMENT_H
+#define BELIEF_SG_CORE_TOURNAMENT_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Belief-SG/core/agent.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/game_record.h"
+#include "Belief-SG/core/thread_pool.h"
+
+namespace belief_sg {
+
+// Builds a fresh agent for each match, so that no agent is shared between threads
+using AgentFactory = std::function<std::unique_ptr<Agent>()>;
+
+// Results of the matches of a Tournament, for each agent of the lineup whatever its seat
+struct TournamentResults {
+    int n_matches = 0;
+    // Joint actions over all the matches
+    long long n_steps = 0;
+    double seconds = 0.0;
+    // Returns of each agent of the lineup in each match, in the order of the matches
+    std::vector<std::vector<double>> returns;
+    std::vector<double> mean_returns;
+    // Half-width of the 95% confidence interval of each mean return, from the normal
+    // approximation with the sample standard deviation
+    std::vector<double> confidence_radii;
+
+    [[nodiscard]] double games_per_second() const {
+        return seconds == 0.0 ? 0.0 : n_matches / seconds;
+    }
+    [[nodiscard]] double steps_per_second() const {
+        return seconds == 0.0 ? 0.0 : n_steps / seconds;
+    }
+};
+
+// Plays many matches of a game between a lineup of agents, one per player, each match with its
+// own `Manager` on a thread pool. Match `m` is seeded with `match_seed(m)` and, with seat
+// rotation, seats the lineup shifted by `m` players, so that every agent plays every seat equally
+// often over a multiple of the number of players. The results do not depend on the number of
+// threads as long as the agents play without time budgets.
+class Tournament {
+public:
+    Tournament(std::shared_ptr<Game> game, std::vector<AgentFactory> lineup);
+
+    void set_n_threads(int n_threads);
+    // Seed of the whole tournament, drawn from `std::random_device` unless set
+    void set_seed(std::uint64_t seed);
+    [[nodiscard]] std::uint64_t seed() const;
+    // On by default; off, agent `i` of the lineup always plays player `i`
+    void set_seat_rotation(bool seat_rotation);
+    // Appends the record of every match to `writer`, in the order in which they end
+    void set_record_writer(std::shared_ptr<GameRecordWriter> writer, bool with_observations = false);
+
+    // Seed of the `Manager` of match `match_id`, numbered stream of the tournament seed
+    [[nodiscard]] std::uint64_t match_seed(int match_id) const;
+    // Index in the lineup of the agent playing each player in match `match_id`
+    [[nodiscard]] std::vector<int> seating(int match_id) const;
+
+    // Plays matches 0 to `n_matches - 1`
+    TournamentResults run(int n_matches) const;
+    // Plays match `match_id` alone and returns the returns of each player
+    [[nodiscard]] std::vector<double> play_match(int match_id, int* n_steps = nullptr) const;
+private:
+    std::shared_ptr<Game> game_;
+    std::vector<AgentFactory> lineup_;
+    std::uint64_t seed_;
+    bool seat_rotation_ = true;
+    std::shared_ptr<GameRecordWriter> record_writer_;
+    bool record_observations_ = false;
+    // Absent when playing in the calling thread
+    std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_CORE_TOURNAMENT_H
@@ -1,6 +1,7 @@
 #ifndef BELIEF_SG_CORE_VARIABLE_H
 #define BELIEF_SG_CORE_VARIABLE_H
 
+#include <cstdint>
 #include <variant>
 #include <string>
 #include <vector>
@@ -27,6 +28,9 @@ public:
 
     [[nodiscard]] std::string to_string() const;
 
+    // Hash of the name and the value, equal variables having equal hashes
+    [[nodiscard]] std::uint64_t hash() const;
+
     bool operator==(const Variable& other) const;
 private:
     std::string name_;
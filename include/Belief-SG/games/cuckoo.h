@@ -28,6 +28,7 @@ public:
 
     [[nodiscard]] bool is_terminal(const State& state) const override;
     [[nodiscard]] std::vector<double> returns(const State& state) const override;
+    [[nodiscard]] double min_return() const override;
 private:
     [[nodiscard]] std::vector<PlayerId> all_players() const;
 
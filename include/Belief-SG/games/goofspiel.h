@@ -15,7 +15,8 @@ namespace belief_sg {
 
 class Goofspiel : public Game {
 public:
-    explicit Goofspiel(int num_players);
+    // Each player, and the prize deck, holds the cards of rank 1 to `num_cards`
+    explicit Goofspiel(int num_players, int num_cards = 13);
 
     [[nodiscard]] std::string name() const override;
 
@@ -28,10 +29,12 @@ public:
 
     [[nodiscard]] bool is_terminal(const State& state) const override;
     [[nodiscard]] std::vector<double> returns(const State& state) const override;
+    [[nodiscard]] double min_return() const override;
 private:
     [[nodiscard]] std::vector<PlayerId> all_players() const;
 
     int num_players_;
+    int num_cards_;
     PlayGraph play_graph_;
 
     std::vector<std::shared_ptr<const PieceType>> card_types_;
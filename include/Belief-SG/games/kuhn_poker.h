@@ -25,6 +25,7 @@ public:
 
     [[nodiscard]] bool is_terminal(const State& state) const override;
     [[nodiscard]] std::vector<double> returns(const State& state) const override;
+    [[nodiscard]] double min_return() const override;
 private:
 
     [[nodiscard]] static bool wins(const PieceValue& value_first, const PieceValue& value_second);
@@ -17,10 +17,15 @@ public:
 
     [[nodiscard]] std::vector<ProbTransition> apply(const State& state) const override;
     void apply_inplace(State& state, std::mt19937& generator) const override;
+    void apply_inplace_observed(State& state, std::mt19937& generator, Observation& observation) const override;
+    void apply_observation(State& state, const Observation& observation, std::size_t& draw_id) const override;
     [[nodiscard]] std::unique_ptr<Move> clone() const override;
 private:
     Position from_;
 
+    // Assigns the values of the two pieces of the cell and removes those that lose the battle
+    void fight(State& state, const PieceValue& value_0, const PieceValue& value_1) const;
+
     [[nodiscard]] bool is_equals(const Move& other) const override;
 };
 
@@ -39,6 +44,7 @@ public:
 
     [[nodiscard]] bool is_terminal(const State& state) const override;
     [[nodiscard]] std::vector<double> returns(const State& state) const override;
+    [[nodiscard]] double min_return() const override;
 private:
 
     int num_players_{2};
@@ -0,0 +1,47 @@
+#ifndef BELIEF_SG_SOLVERS_BEST_RESPONSE_H
+#define BELIEF_SG_SOLVERS_BEST_RESPONSE_H
+
+#include <memory>
+#include <vector>
+
+#include "Belief-SG/core/agent.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/thread_pool.h"
+#include "Belief-SG/solvers/game_tree.h"
+
+namespace belief_sg {
+
+// Best responses to a policy of a `GameTree`, and how much they gain over it. A best response
+// plays, at each information set of its player, the action with the highest value summed over the
+// nodes of the set, each weighted by the probability that chance and the other players reach it.
+// The values of the nodes and the actions of the information sets are each computed once.
+class BestResponse {
+public:
+    explicit BestResponse(std::shared_ptr<const GameTree> tree);
+
+    // The best responses of the players are computed in parallel
+    void set_n_threads(int n_threads);
+
+    // Pure policy playing, at each information set, the action its agent chooses there. Each agent
+    // is asked once per information set of its player, from the first states of the set met in the
+    // tree, so a randomized agent is evaluated on one draw of its choices.
+    [[nodiscard]] std::vector<double> agent_policy(const std::vector<std::unique_ptr<Agent>>& agents) const;
+
+    // Value for each player of a best response to the policy of the other players
+    [[nodiscard]] std::vector<double> best_response_values(const std::vector<double>& policy) const;
+    // Sum over the players of what a best response gains over `policy`, zero at a Nash equilibrium
+    [[nodiscard]] double nash_conv(const std::vector<double>& policy) const;
+    // NashConv divided by the number of players, the usual exploitability of two-player
+    // constant-sum games
+    [[nodiscard]] double exploitability(const std::vector<double>& policy) const;
+private:
+    [[nodiscard]] double best_response_value(PlayerId player, const std::vector<double>& policy) const;
+
+    std::shared_ptr<const GameTree> tree_;
+    // Absent when computing in the calling thread
+    std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_SOLVERS_BEST_RESPONSE_H
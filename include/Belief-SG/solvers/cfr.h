@@ -0,0 +1,119 @@
+#ifndef BELIEF_SG_SOLVERS_CFR_H
+#define BELIEF_SG_SOLVERS_CFR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/state.h"
+#include "Belief-SG/core/thread_pool.h"
+#include "Belief-SG/solvers/game_tree.h"
+
+namespace belief_sg {
+
+enum class CFRVariant : std::uint8_t {
+    Vanilla,          // Regret matching on the cumulated regrets, uniform averaging
+    Plus,             // Regrets floored at zero, averaging weighted by the iteration
+    ExternalSampling  // Monte Carlo CFR sampling chance and the actions of the other players
+};
+
+// Measurements of the runs of a CFRSolver
+struct CFRStats {
+    int n_iterations = 0;
+    // Time spent in iterations
+    double seconds = 0.0;
+    // Time spent enumerating the game tree
+    double build_seconds = 0.0;
+
+    [[nodiscard]] double iterations_per_second() const {
+        return seconds == 0.0 ? 0.0 : n_iterations / seconds;
+    }
+};
+
+// Counterfactual regret minimization over the `GameTree` of a small game.
+// Simultaneous actions are handled by computing the counterfactual value of each action of a
+// player against the current strategies of the other players acting at the same node.
+class CFRSolver {
+public:
+    explicit CFRSolver(std::shared_ptr<Game> game, CFRVariant variant = CFRVariant::Plus);
+
+    // The traversals of the full variants are split at the first depth with enough nodes to keep
+    // `n_threads` threads busy; sampled iterations run in batches of `n_threads` against the
+    // strategy at the start of the batch. Updates are summed in a fixed order, so the results
+    // only depend on the number of threads through rounding and batching.
+    void set_n_threads(int n_threads);
+    // Seed of the external sampling, drawn from `std::random_device` unless set. Sampled
+    // iteration `i` draws from stream `i` of the seed, so that runs with the same seed and number
+    // of threads are reproducible.
+    void set_seed(std::uint64_t seed);
+
+    // Runs `n_iterations` more iterations
+    void run(int n_iterations);
+
+    // Average strategy of the information set of `private_state`, over the legal actions of its
+    // player in their order
+    [[nodiscard]] std::vector<double> average_strategy(const State& private_state) const;
+    // Average strategies of all the information sets, as a policy of the tree
+    [[nodiscard]] std::vector<double> average_policy() const;
+    // Expected returns of each player when all follow their average strategy
+    [[nodiscard]] std::vector<double> average_returns() const;
+
+    [[nodiscard]] const std::shared_ptr<const GameTree>& tree() const;
+    [[nodiscard]] std::size_t n_nodes() const;
+    [[nodiscard]] std::size_t n_information_sets() const;
+    [[nodiscard]] const CFRStats& stats() const;
+private:
+    // Changes to the flat tables during one iteration, applied once it is over
+    struct Deltas {
+        std::vector<double> regrets;
+        std::vector<double> strategy_sums;
+    };
+
+    // A node at the depth where full traversals are split, with its reach probabilities
+    struct FrontierNode {
+        int node_id;
+        std::vector<double> reach;
+    };
+
+    void run_full_iteration();
+    void run_sampled_iterations(int n_iterations);
+    void apply(const Deltas& deltas);
+    void update_strategy();
+
+    // Index of each player in the reach vectors, the last one for chance
+    [[nodiscard]] int reach_index(PlayerId player) const;
+
+    void collect_frontier(int node_id, const std::vector<double>& reach, std::vector<FrontierNode>& frontier) const;
+    // Values of the node for every player under the current strategy, adding the regrets and
+    // strategy sums of its subtree to `deltas`. Nodes at the split depth take their values from
+    // `frontier_values` in traversal order, when given.
+    std::vector<double> traverse(int node_id, const std::vector<double>& reach, Deltas& deltas, const std::vector<std::vector<double>>* frontier_values, std::size_t& frontier_index) const;
+    // External sampling: value of the node for `traverser`
+    double sample(int node_id, PlayerId traverser, Deltas& deltas, std::mt19937& generator) const;
+
+    std::shared_ptr<const GameTree> tree_;
+    CFRVariant variant_;
+    int n_players_;
+
+    std::vector<double> regrets_;
+    std::vector<double> strategy_sums_;
+    // Regret matching strategy of the current iteration
+    std::vector<double> strategy_;
+
+    std::uint64_t seed_;
+    // Sampled iterations run so far, numbering the random stream of the next one
+    std::uint64_t n_sampled_iterations_ = 0;
+    // Absent when iterating in the calling thread
+    std::unique_ptr<ThreadPool> thread_pool_;
+    // Depth at which full traversals are split between the threads, -1 if they are not
+    int split_depth_ = -1;
+    CFRStats stats_;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_SOLVERS_CFR_H
@@ -0,0 +1,105 @@
+#ifndef BELIEF_SG_SOLVERS_GAME_TREE_H
+#define BELIEF_SG_SOLVERS_GAME_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Belief-SG/core/action.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/state.h"
+
+namespace belief_sg {
+
+// Whole tree of a small game, enumerated once from the initial world state with
+// `Game::apply_joint_action`, keeping the probabilities of the transitions and merging those to
+// equal states. Chance plays uniformly as in the manager. Each player follows its private state
+// along the way, taking the private transition consistent with the world state, and the private
+// states with the same hash form an information set.
+// A policy of the tree gives a probability to every action of every information set, in a flat
+// vector of `n_actions()` entries where the actions of a set start at its `offset`.
+class GameTree {
+public:
+    struct Outcome {
+        double probability;
+        int node_id;
+    };
+
+    struct Node {
+        // Current players, chance included
+        std::vector<PlayerId> players;
+        // Information set of each current player, -1 for chance
+        std::vector<int> information_sets;
+        std::vector<int> n_actions;
+        // The outcomes of joint action j are outcomes[outcome_offsets[j]] to
+        // outcomes[outcome_offsets[j + 1] - 1]. Joint actions are numbered in mixed radix, the
+        // action of the last player changing fastest.
+        std::vector<int> outcome_offsets;
+        std::vector<Outcome> outcomes;
+        // Only for terminal nodes, which have no players
+        std::vector<double> returns;
+        int depth;
+    };
+
+    // A node of an information set, with the index of the player among its current players
+    struct Member {
+        int node_id;
+        int player_index;
+    };
+
+    struct InformationSet {
+        PlayerId player;
+        int offset;
+        // Legal actions of the player, in the order of `Game::legal_actions`
+        std::vector<Action> actions;
+        // States of the first node of the set met during the enumeration
+        State private_state;
+        State public_state;
+        std::vector<Member> members;
+    };
+
+    explicit GameTree(std::shared_ptr<Game> game);
+
+    [[nodiscard]] const std::shared_ptr<Game>& game() const;
+    [[nodiscard]] int num_players() const;
+
+    // The root is node 0, and the children of a node come after it
+    [[nodiscard]] const std::vector<Node>& nodes() const;
+    [[nodiscard]] const std::vector<InformationSet>& information_sets() const;
+    // Number of nodes at each depth
+    [[nodiscard]] const std::vector<int>& depth_counts() const;
+    // Size of the policies of the tree
+    [[nodiscard]] std::size_t n_actions() const;
+
+    // Information set of `private_state`, -1 if no node of the tree has it
+    [[nodiscard]] int find_information_set(const State& private_state) const;
+
+    // Probability of the action of the current player at `player_index` under `policy`
+    [[nodiscard]] double action_probability(const Node& node, int player_index, int action_id, const std::vector<double>& policy) const;
+    // Policy playing every action of every information set with the same probability
+    [[nodiscard]] std::vector<double> uniform_policy() const;
+    // Expected returns of each player when all follow `policy`
+    [[nodiscard]] std::vector<double> expected_returns(const std::vector<double>& policy) const;
+private:
+    int build(const State& world_state, const std::vector<State>& private_states, const State& public_state, int depth);
+    int information_set_id(PlayerId player_id, const State& private_state, const State& public_state, std::vector<Action> actions);
+    // Successor of `state` after `joint_action`, consistent with the world state `world_state`
+    [[nodiscard]] State observe(const State& state, const std::vector<Action>& joint_action, const State& world_state) const;
+    [[nodiscard]] std::vector<double> evaluate(int node_id, const std::vector<double>& policy) const;
+
+    std::shared_ptr<Game> game_;
+    int n_players_;
+
+    std::vector<Node> nodes_;
+    std::vector<int> depth_counts_;
+    std::unordered_map<std::uint64_t, int> information_set_ids_;
+    std::vector<InformationSet> information_sets_;
+    std::size_t n_actions_ = 0;
+};
+
+}  // namespace belief_sg
+
+#endif  //BELIEF_SG_SOLVERS_GAME_TREE_H
@@ -1,21 +1,26 @@
 #include "Belief-SG/agents/determinized_mc.h"
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <random>
-#include <iostream>
+#include <span>
+#include <stdexcept>
 
 #include "Belief-SG/core/action.h"
 #include "Belief-SG/core/game.h"
 #include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/seeding.h"
 #include "Belief-SG/core/state.h"
 
 namespace belief_sg {
 
-DeterminizedMC::DeterminizedMC() : generator_(std::random_device{}()), n_samples_(10), n_iterations_(1000), use_prob_(false) {}
+DeterminizedMC::DeterminizedMC() : generator_(make_generator(random_seed())), n_samples_(10), n_iterations_(1000), use_prob_(false) {}
 
-DeterminizedMC::DeterminizedMC(int n_samples, int n_iterations, bool use_prob) : generator_(std::random_device{}()), n_samples_(n_samples), n_iterations_(n_iterations), use_prob_(use_prob) {}
+DeterminizedMC::DeterminizedMC(int n_samples, int n_iterations, bool use_prob) : generator_(make_generator(random_seed())), n_samples_(n_samples), n_iterations_(n_iterations), use_prob_(use_prob) {}
 
 void DeterminizedMC::set_game(std::shared_ptr<Game> game) {
     game_ = game;
@@ -25,100 +30,183 @@ void DeterminizedMC::set_player(PlayerId player) {
     player_ = player;
 }
 
+void DeterminizedMC::set_seed(std::uint64_t seed) {
+    generator_ = make_generator(seed);
+}
+
+void DeterminizedMC::set_n_threads(int n_threads) {
+    if (n_threads < 1) {
+        throw std::invalid_argument("DeterminizedMC needs at least one thread");
+    }
+    thread_pool_ = n_threads == 1 ? nullptr : std::make_unique<ThreadPool>(n_threads);
+}
+
+void DeterminizedMC::set_time_budget(std::chrono::milliseconds time_budget) {
+    if (time_budget.count() < 0) {
+        throw std::invalid_argument("The time budget cannot be negative");
+    }
+    time_budget_ = time_budget;
+}
+
+const DeterminizedMCStats& DeterminizedMC::stats() const {
+    return stats_;
+}
+
 Action DeterminizedMC::act(const State& private_state, const State& public_state) {
+    auto decision_start = std::chrono::steady_clock::now();
     std::vector<ProbAction> actions = game_->legal_actions(private_state, player_);
 
     if (actions.size() == 1) {
         return actions.back().action;
     }
 
-    std::vector<ActionInfo> action_infos(actions.size());
-    for (size_t i = 0; i < actions.size(); ++i) {
-        action_infos[i].action = actions[i].action;
-        action_infos[i].total_reward = 0.0;
-        action_infos[i].visit_count = 0;
-    }
-
+    const int n_actions = static_cast<int>(actions.size());
+    const int n_threads = thread_pool_ == nullptr ? 1 : thread_pool_->size();
+    std::vector<WorkItem> items;
+    std::function<void(int)> run_task;
     std::vector<State> determinized_states;
-    determinized_states.reserve(n_samples_);
-    for (int i = 0; i < n_samples_; i++) {
-        State state(private_state);
-        if (use_prob_) {
-            state.determinize_with_marginals(generator_);
-        } else {
-            state.determinize(generator_);
+    // The items take numbered streams, so that the agent's generator advances by the same amount
+    // whatever the number of items
+    const std::uint64_t decision_seed = draw_seed(generator_);
+    if (time_budget_.count() == 0) {
+        determinized_states.reserve(n_samples_);
+        for (int i = 0; i < n_samples_; i++) {
+            State state(private_state);
+            if (use_prob_) {
+                state.determinize_with_marginals(generator_);
+            } else {
+                state.determinize(generator_, false);
+            }
+            determinized_states.push_back(state);
+        }
+        // Item `action_id * n_samples_ + sample_id` plays `action_id` out from `sample_id`
+        items.resize(n_actions * n_samples_);
+        for (int item_id = 0; item_id < static_cast<int>(items.size()); ++item_id) {
+            items[item_id] = {.seed = stream_seed(decision_seed, item_id), .action_id = item_id / n_samples_};
+        }
+        run_task = [&](int item_id) {
+            run_playouts(actions[items[item_id].action_id].action, determinized_states[item_id % n_samples_], items[item_id]);
+        };
+    } else {
+        // Item `task_id * n_actions + action_id` gathers the playouts of `action_id` by the
+        // task `task_id`, which runs on its own thread until the deadline
+        const auto deadline = decision_start + time_budget_;
+        items.resize(n_threads * n_actions);
+        for (int item_id = 0; item_id < static_cast<int>(items.size()); ++item_id) {
+            items[item_id] = {.seed = stream_seed(decision_seed, item_id), .action_id = item_id % n_actions};
         }
-        determinized_states.push_back(state);
+        run_task = [&](int task_id) {
+            run_timed_playouts(private_state, actions, std::span(items).subspan(task_id * n_actions, n_actions), deadline);
+        };
+    }
+    const int n_tasks = time_budget_.count() == 0 ? static_cast<int>(items.size()) : n_threads;
+    if (thread_pool_ == nullptr) {
+        for (int task_id = 0; task_id < n_tasks; ++task_id) {
+            run_task(task_id);
+        }
+    } else {
+        thread_pool_->parallel_for(n_tasks, run_task);
     }
 
-    int iter = 0;
-
-    double total_time = 0.0;
-
-    for (ActionInfo& action_info : action_infos) {
-        for (const State& determinized_state : determinized_states) {
-            for (int i = 0; i < n_iterations_ / n_samples_; ++i) {
-
-                auto start_time = std::chrono::high_resolution_clock::now();
-                State state(determinized_state);
-
-                std::vector<Action> joint_action(state.current_players().size());
-                for (PlayerId player_id : state.current_players()) {
-                    if (player_id == player_) {
-                        joint_action.push_back(action_info.action);
-                    } else {
-                        std::vector<ProbAction> prob_actions = game_->legal_actions(state, player_id);
-                        std::uniform_int_distribution<int> distribution(0, static_cast<int>(prob_actions.size()) - 1);
-                        joint_action.push_back(prob_actions[distribution(generator_)].action);
-                    }
-                }
-
-                game_->apply_joint_action_inplace(state, joint_action, generator_);
-
-                int playout_iter = 0;
-                while (!game_->is_terminal(state) && playout_iter < 200) {
-                    std::vector<Action> joint_action(state.current_players().size());
-                    for (PlayerId player_id : state.current_players()) {
-                        std::vector<ProbAction> prob_actions = game_->legal_actions(state, player_id);
-                        std::uniform_int_distribution<int> distribution(0, static_cast<int>(prob_actions.size()) - 1);
-                        joint_action.push_back(prob_actions[distribution(generator_)].action);
-                    }
+    stats_ = {.n_threads = n_threads};
+    std::vector<double> total_rewards(n_actions, 0.0);
+    std::vector<int> visit_counts(n_actions, 0);
+    for (const WorkItem& item : items) {
+        total_rewards[item.action_id] += item.total_reward;
+        visit_counts[item.action_id] += item.visit_count;
+        stats_.n_playouts += item.visit_count;
+        stats_.playout_seconds += item.seconds;
+    }
 
-                    game_->apply_joint_action_inplace(state, joint_action, generator_);
+    Action max_action = actions[0].action;
+    double max_expected_reward = total_rewards[0] / visit_counts[0];
 
-                    playout_iter++;
-                }
+    for (size_t i = 1; i < actions.size(); ++i) {
+        if (total_rewards[i] / visit_counts[i] > max_expected_reward) {
+            max_action = actions[i].action;
+            max_expected_reward = total_rewards[i] / visit_counts[i];
+        }
+    }
 
+    stats_.decision_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - decision_start).count();
 
-                action_info.total_reward += game_->returns(state)[player_];
-                action_info.visit_count++;
+    return max_action;
+}
 
-                iter++;
+void DeterminizedMC::run_playouts(const Action& action, const State& determinized_state, WorkItem& item) const {
+    auto start_time = std::chrono::steady_clock::now();
+    std::mt19937 generator = make_generator(item.seed);
+    // The determinization is shared by the items of every action, each item plays out from its
+    // own copy
+    State state(determinized_state);
+    for (int i = 0; i < n_iterations_ / n_samples_; ++i) {
+        item.total_reward += playout(action, state, generator);
+        item.visit_count++;
+    }
+    item.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
 
-                auto end_time = std::chrono::high_resolution_clock::now();
+void DeterminizedMC::run_timed_playouts(const State& private_state, const std::vector<ProbAction>& actions, std::span<WorkItem> items, std::chrono::steady_clock::time_point deadline) const {
+    auto start_time = std::chrono::steady_clock::now();
+    std::mt19937 generator = make_generator(items[0].seed);
+    // Every round plays each action out once from a new determinization. The first round always
+    // completes, so that every action has been evaluated; the others stop at the deadline.
+    bool first_round = true;
+    do {
+        State state(private_state);
+        if (use_prob_) {
+            state.determinize_with_marginals(generator);
+        } else {
+            state.determinize(generator, false);
+        }
+        for (WorkItem& item : items) {
+            if (!first_round && std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+            item.total_reward += playout(actions[item.action_id].action, state, generator);
+            item.visit_count++;
+        }
+        first_round = false;
+    } while (std::chrono::steady_clock::now() < deadline);
+    items[0].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
 
-                total_time += std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time).count();
+double DeterminizedMC::playout(const Action& action, State& state, std::mt19937& generator) const {
+    // The playout is undone afterwards instead of running on a copy
+    State::Checkpoint checkpoint = state.checkpoint();
 
-                if (iter % 1000 == 0) {
-                    std::cout << total_time / iter << "\n";
-                }
-            }
+    std::vector<Action> joint_action;
+    joint_action.reserve(state.current_players().size());
+    for (PlayerId player_id : state.current_players()) {
+        if (player_id == player_) {
+            joint_action.push_back(action);
+        } else {
+            std::vector<ProbAction> prob_actions = game_->legal_actions(state, player_id);
+            std::uniform_int_distribution<int> distribution(0, static_cast<int>(prob_actions.size()) - 1);
+            joint_action.push_back(prob_actions[distribution(generator)].action);
         }
     }
 
-    std::cout << total_time << "\n";
-
-    Action max_action = action_infos[0].action;
-    double max_expected_reward = action_infos[0].total_reward / action_infos[0].visit_count;
+    game_->apply_joint_action_inplace(state, joint_action, generator);
 
-    for (size_t i = 1; i < action_infos.size(); ++i) {
-        if (action_infos[i].total_reward / action_infos[i].visit_count > max_expected_reward) {
-            max_action = action_infos[i].action;
-            max_expected_reward = action_infos[i].total_reward / action_infos[i].visit_count;
+    int playout_iter = 0;
+    while (!game_->is_terminal(state) && playout_iter < 200) {
+        std::vector<Action> joint_action;
+        joint_action.reserve(state.current_players().size());
+        for (PlayerId player_id : state.current_players()) {
+            std::vector<ProbAction> prob_actions = game_->legal_actions(state, player_id);
+            std::uniform_int_distribution<int> distribution(0, static_cast<int>(prob_actions.size()) - 1);
+            joint_action.push_back(prob_actions[distribution(generator)].action);
         }
+
+        game_->apply_joint_action_inplace(state, joint_action, generator);
+
+        playout_iter++;
     }
 
-    return max_action;
+    double reward = game_->returns(state)[player_];
+    state.rollback(checkpoint);
+    return reward;
 }
 
 }  // namespace belief_sg
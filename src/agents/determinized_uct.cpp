@@ -2,37 +2,57 @@
 
 #include "Belief-SG/core/action.h"
 #include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/seeding.h"
 #include "Belief-SG/core/state.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <memory>
-#include <random>
+#include <mutex>
 #include <optional>
+#include <random>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace belief_sg {
 
-NodeUCT::NodeUCT(const std::shared_ptr<Game>& game, const State& state, NodeUCT* parent_node, std::optional<std::vector<Action>> parent_joint_action) : state(state), parent_node(parent_node), parent_joint_action(std::move(parent_joint_action)), n_visits(-1) {
+NodeUCT::NodeUCT(const std::shared_ptr<Game>& game, State node_state, std::pmr::memory_resource* memory)
+    : state(std::move(node_state)), n_visits(-1), actions(memory), successors(memory) {
     if (game->is_terminal(state)) {
         return;
     }
 
     const std::vector<PlayerId>& current_players = state.current_players();
-    actions = std::vector<std::vector<NodeUCT::ActionInfo>>(
-        current_players.size(),
-        std::vector<NodeUCT::ActionInfo>()
-    );
+    actions.resize(current_players.size());
     for (int i = 0; i < current_players.size(); ++i) {
         std::vector<ProbAction> legal_actions = game->legal_actions(state, current_players[i]);
         actions[i].reserve(legal_actions.size());
         for (const auto& prob_action : legal_actions) {
             actions[i].push_back(
-                {.action = prob_action.action, .n_visits = 0, .sum_results = 0.0}
+                {.action = prob_action.action, .n_visits = 0, .sum_results = 0.0, .n_virtual_losses = 0}
             );
         }
     }
 }
 
+NodeUCT::NodeUCT(const NodeUCT& other, std::pmr::memory_resource* memory)
+    : state(other.state),
+      n_visits(other.n_visits.load()),
+      actions(other.actions, memory),
+      successors(other.successors, memory) {
+    for (auto& action_infos : actions) {
+        for (auto& action_info : action_infos) {
+            action_info.n_virtual_losses = 0;
+        }
+    }
+}
+
 bool NodeUCT::is_fully_expanded() const {
     for (const auto& action_infos : actions) {
         for (const auto& action_info : action_infos) {
@@ -44,54 +64,153 @@ bool NodeUCT::is_fully_expanded() const {
     return true;
 }
 
-DeterminizedUCT::DeterminizedUCT() : generator_(std::random_device{}()), n_samples_(10), n_iterations_(1000), use_prob_(false) {}
+DeterminizedUCT::DeterminizedUCT() : DeterminizedUCT(10, 1000, false) {}
+
+DeterminizedUCT::DeterminizedUCT(int n_samples, int n_iterations, bool use_prob) : DeterminizedUCT(n_samples, n_iterations, use_prob, TranspositionOptions()) {}
 
-DeterminizedUCT::DeterminizedUCT(int n_samples, int n_iterations, bool use_prob) : generator_(std::random_device{}()), n_samples_(n_samples), n_iterations_(n_iterations), use_prob_(use_prob) {}
+DeterminizedUCT::DeterminizedUCT(int n_samples, int n_iterations, bool use_prob, TranspositionOptions transpositions)
+    : generator_(make_generator(random_seed())),
+      n_samples_(n_samples),
+      n_iterations_(n_iterations),
+      use_prob_(use_prob),
+      transpositions_(transpositions) {}
 
 void DeterminizedUCT::set_game(std::shared_ptr<Game> game) {
     game_ = game;
+    contexts_.clear();
 }
 
 void DeterminizedUCT::set_player(PlayerId player) {
     player_ = player;
+    contexts_.clear();
+}
+
+void DeterminizedUCT::set_seed(std::uint64_t seed) {
+    generator_ = make_generator(seed);
+    contexts_.clear();
+}
+
+void DeterminizedUCT::set_n_threads(int n_threads, Parallelism parallelism) {
+    if (n_threads < 1) {
+        throw std::invalid_argument("DeterminizedUCT needs at least one thread");
+    }
+    thread_pool_ = n_threads == 1 ? nullptr : std::make_unique<ThreadPool>(n_threads);
+    parallelism_ = parallelism;
+    // The kept trees have a generator per thread of the previous setting
+    contexts_.clear();
+}
+
+void DeterminizedUCT::set_virtual_loss(int virtual_loss, std::optional<double> loss_value) {
+    if (virtual_loss < 0) {
+        throw std::invalid_argument("The virtual loss cannot be negative");
+    }
+    virtual_loss_ = virtual_loss;
+    virtual_loss_value_ = loss_value;
+}
+
+void DeterminizedUCT::set_time_budget(std::chrono::milliseconds time_budget) {
+    if (time_budget.count() < 0) {
+        throw std::invalid_argument("The time budget cannot be negative");
+    }
+    time_budget_ = time_budget;
+}
+
+void DeterminizedUCT::set_tree_reuse(bool tree_reuse) {
+    tree_reuse_ = tree_reuse;
+    contexts_.clear();
 }
 
 Action DeterminizedUCT::act(const State& private_state, const State& public_state) {
+    const auto deadline = time_budget_.count() == 0
+        ? std::chrono::steady_clock::time_point::max()
+        : std::chrono::steady_clock::now() + time_budget_;
+
+    // Kept trees are advanced even through forced moves, the next decision continues from there
+    if (tree_reuse_) {
+        reuse_trees(private_state);
+    } else {
+        contexts_.clear();
+    }
 
     std::vector<ProbAction> actions = game_->legal_actions(private_state, player_);
     if (actions.size() == 1) {
+        last_action_ = actions[0].action;
         return actions[0].action;
     }
 
-    roots_.clear();
-    roots_.reserve(n_samples_);
-    for (int sample_i = 0; sample_i < n_samples_; ++sample_i) {
+    const bool tree_parallel = thread_pool_ != nullptr && parallelism_ == Parallelism::Tree;
+    const int n_generators = tree_parallel ? thread_pool_->size() : 1;
+    // The determinizations only share the unmodified components of their states
+    contexts_.reserve(n_samples_);
+    while (static_cast<int>(contexts_.size()) < n_samples_) {
         State determinized_state(private_state);
         if (use_prob_) {
             determinized_state.determinize_with_marginals(generator_);
         } else {
-            determinized_state.determinize(generator_);
+            determinized_state.determinize(generator_, false);
         }
-        roots_.push_back(std::make_unique<NodeUCT>(game_, determinized_state));
-        roots_.back()->n_visits++;
+        auto context = std::make_unique<SearchContext>(transpositions_, tree_parallel);
+        context->root = context->make_node(game_, std::move(determinized_state));
+        context->root->n_visits++;
+        // One numbered stream per thread, so that the next determinizations do not depend on the
+        // number of threads
+        const std::uint64_t context_seed = draw_seed(generator_);
+        for (int generator_i = 0; generator_i < n_generators; ++generator_i) {
+            context->generators.push_back(make_generator(stream_seed(context_seed, generator_i)));
+        }
+        if (transpositions_.enabled) {
+            context->transposition_table.store(context->root);
+        }
+        contexts_.push_back(std::move(context));
     }
 
-    for (const auto& root : roots_) {
-        for (int playout_i = 0; playout_i < n_iterations_; ++playout_i) {
-            run_playout(root.get());
+    // Reused roots already have some of their visits
+    std::vector<int> n_missing_playouts(n_samples_);
+    for (int sample_id = 0; sample_id < n_samples_; ++sample_id) {
+        n_missing_playouts[sample_id] = std::max(0, n_iterations_ - contexts_[sample_id]->root->n_visits);
+    }
+    auto search_round = [&](int n_playouts) {
+        auto search_sample = [&](int sample_id) {
+            const int n_sample_playouts = n_playouts < 0 ? n_missing_playouts[sample_id] : n_playouts;
+            search(contexts_[sample_id]->root, *contexts_[sample_id], n_sample_playouts, deadline);
+        };
+        if (thread_pool_ == nullptr || tree_parallel) {
+            for (int sample_id = 0; sample_id < n_samples_; ++sample_id) {
+                search_sample(sample_id);
+            }
+        } else {
+            thread_pool_->parallel_for(n_samples_, search_sample);
         }
-        root->successors.clear();
+    };
+    if (time_budget_.count() == 0) {
+        search_round(-1);
+    } else {
+        do {
+            search_round(kPlayoutsPerRound * n_generators);
+        } while (std::chrono::steady_clock::now() < deadline);
+    }
+
+    transposition_stats_ = {};
+    n_nodes_ = 0;
+    arena_bytes_ = 0;
+    n_playouts_ = 0;
+    for (int sample_id = 0; sample_id < n_samples_; ++sample_id) {
+        n_playouts_ += contexts_[sample_id]->n_playouts;
+        transposition_stats_ += contexts_[sample_id]->transposition_table.stats();
+        n_nodes_ += contexts_[sample_id]->nodes.size();
+        arena_bytes_ += contexts_[sample_id]->arena.bytes_used();
     }
 
     std::vector<std::pair<Action, int>> action_visits;
     for (int sample_id = 0; sample_id < n_samples_; ++sample_id) {
-        std::vector<PlayerId> current_players = roots_[sample_id]->state.current_players();
+        const NodeUCT* root = contexts_[sample_id]->root;
+        std::vector<PlayerId> current_players = root->state.current_players();
         auto it = std::ranges::find(current_players, player_);
         if (it == current_players.end()) {
             throw std::runtime_error("Player not found in current players");
         }
         std::size_t action_id = std::distance(current_players.begin(), it);
-        for (const auto& action_info : roots_[sample_id]->actions[action_id]) {
+        for (const auto& action_info : root->actions[action_id]) {
             auto it = std::ranges::find_if(action_visits, [&](const auto& pair) {
                 return pair.first == action_info.action;
             });
@@ -112,113 +231,332 @@ Action DeterminizedUCT::act(const State& private_state, const State& public_stat
         }
     }
 
-    roots_.clear();
+    if (!tree_reuse_) {
+        contexts_.clear();
+    }
+    last_action_ = max_action;
 
     return max_action;
 }
 
-void DeterminizedUCT::run_playout(NodeUCT* root) {
-    NodeUCT* child = select_and_expand(root);
-    std::vector<double> result = simulate(child);
-    backpropagate(child, result);
+const TranspositionStats& DeterminizedUCT::transposition_stats() const {
+    return transposition_stats_;
+}
+
+std::size_t DeterminizedUCT::n_nodes() const {
+    return n_nodes_;
+}
+
+std::size_t DeterminizedUCT::arena_bytes() const {
+    return arena_bytes_;
+}
+
+int DeterminizedUCT::n_playouts() const {
+    return n_playouts_;
+}
+
+DeterminizedUCT::SearchContext::SearchContext(const TranspositionOptions& transpositions, bool shared_tree)
+    : arena(shared_tree),
+      transposition_table(transpositions.enabled ? transpositions.max_nodes : 0, transpositions.replacement_policy),
+      shared(shared_tree) {}
+
+DeterminizedUCT::SearchContext::~SearchContext() {
+    // The nodes own states and actions outside of the arena
+    for (NodeUCT* node : nodes) {
+        node->~NodeUCT();
+    }
+    if (root != nullptr) {
+        root->~NodeUCT();
+    }
+}
+
+void DeterminizedUCT::reuse_trees(const State& private_state) {
+    std::vector<std::unique_ptr<SearchContext>> contexts;
+    for (const auto& context : contexts_) {
+        NodeUCT* new_root = find_consistent_node(context->root, private_state);
+        if (new_root == nullptr) {
+            continue;
+        }
+
+        // The nodes reachable from the new root are copied to a new tree, so that the arena of
+        // the old one is freed with the rest of its nodes
+        auto reused = std::make_unique<SearchContext>(transpositions_, context->shared);
+        reused->generators = std::move(context->generators);
+        reused->root = reused->make_node(*new_root);
+        std::unordered_map<NodeUCT*, NodeUCT*> copies = {{new_root, reused->root}};
+        std::vector<NodeUCT*> to_visit = {new_root};
+        while (!to_visit.empty()) {
+            NodeUCT* node = to_visit.back();
+            to_visit.pop_back();
+            for (const NodeUCT::SuccessorInfo& successor_info : node->successors) {
+                auto [it, inserted] = copies.try_emplace(successor_info.successor, nullptr);
+                if (inserted) {
+                    it->second = reused->make_node(*successor_info.successor);
+                    reused->nodes.push_back(it->second);
+                    to_visit.push_back(successor_info.successor);
+                }
+            }
+        }
+        for (NodeUCT* node : reused->nodes) {
+            for (NodeUCT::SuccessorInfo& successor_info : node->successors) {
+                successor_info.successor = copies.at(successor_info.successor);
+            }
+        }
+        for (NodeUCT::SuccessorInfo& successor_info : reused->root->successors) {
+            successor_info.successor = copies.at(successor_info.successor);
+        }
+
+        if (transpositions_.enabled) {
+            reused->transposition_table.store(reused->root);
+            for (NodeUCT* node : reused->nodes) {
+                reused->transposition_table.store(node);
+            }
+        }
+        contexts.push_back(std::move(reused));
+    }
+    contexts_ = std::move(contexts);
+}
+
+NodeUCT* DeterminizedUCT::find_consistent_node(NodeUCT* root, const State& private_state) const {
+    // The game went on with the action last returned by the agent
+    const std::vector<PlayerId>& root_players = root->state.current_players();
+    auto player_it = std::ranges::find(root_players, player_);
+    if (player_it == root_players.end()) {
+        return nullptr;
+    }
+    const std::size_t player_index = std::distance(root_players.begin(), player_it);
+    std::unordered_set<NodeUCT*> visited = {root};
+    std::deque<NodeUCT*> to_visit;
+    for (const NodeUCT::SuccessorInfo& successor_info : root->successors) {
+        if (successor_info.joint_action[player_index] == last_action_ && visited.insert(successor_info.successor).second) {
+            to_visit.push_back(successor_info.successor);
+        }
+    }
+    // Breadth-first, so that the node reached by the fewest joint actions is found first. The
+    // agent is asked to act at the first node where it plays, the search does not go past it.
+    while (!to_visit.empty()) {
+        NodeUCT* node = to_visit.front();
+        to_visit.pop_front();
+        if (std::ranges::find(node->state.current_players(), player_) != node->state.current_players().end()) {
+            if (node->state.current_players() == private_state.current_players() && private_state.is_consistent_with(node->state)) {
+                return node;
+            }
+            continue;
+        }
+        for (const NodeUCT::SuccessorInfo& successor_info : node->successors) {
+            if (visited.insert(successor_info.successor).second) {
+                to_visit.push_back(successor_info.successor);
+            }
+        }
+    }
+    return nullptr;
+}
+
+void DeterminizedUCT::search(NodeUCT* root, SearchContext& context, int n_playouts, std::chrono::steady_clock::time_point deadline) {
+    auto expired = [&] {
+        return context.n_playouts > 0 && std::chrono::steady_clock::now() >= deadline;
+    };
+    if (context.generators.size() == 1) {
+        for (int playout_i = 0; playout_i < n_playouts && !expired(); ++playout_i) {
+            run_playout(root, context, context.generators[0]);
+            context.n_playouts++;
+        }
+        return;
+    }
+    // The playouts are handed out one at a time, so that a slow thread does not delay the others
+    std::atomic<int> n_started = 0;
+    thread_pool_->parallel_for(static_cast<int>(context.generators.size()), [&](int thread_id) {
+        while (n_started.fetch_add(1, std::memory_order_relaxed) < n_playouts && !expired()) {
+            run_playout(root, context, context.generators[thread_id]);
+            context.n_playouts++;
+        }
+    });
+}
+
+void DeterminizedUCT::run_playout(NodeUCT* root, SearchContext& context, std::mt19937& generator) {
+    std::vector<PathStep> path;
+    std::vector<Action> frontier_action;
+    NodeUCT* leaf = select_and_expand(root, path, frontier_action, context, generator);
+    std::vector<double> result = simulate(leaf, frontier_action, context, generator);
+    backpropagate(path, leaf, result, context.shared ? virtual_loss_ : 0);
 }
 
-std::vector<Action> DeterminizedUCT::select_joint_action(NodeUCT* node) {
+std::vector<int> DeterminizedUCT::select_action_ids(NodeUCT* node, int virtual_loss) {
     const std::vector<PlayerId>& current_players = node->state.current_players();
+    std::vector<int> action_ids;
+    action_ids.reserve(node->actions.size());
     if (current_players.size() == 1 && current_players[0] == kChancePlayerId) {
         double min_n_visits = std::numeric_limits<double>::infinity();
-        Action action;
-        for (const auto& action_info : node->actions[0]) {
-            if (action_info.n_visits < min_n_visits) {
-                min_n_visits = action_info.n_visits;
-                action = action_info.action;
+        int min_idx = -1;
+        for (int j = 0; j < static_cast<int>(node->actions[0].size()); ++j) {
+            const auto& action_info = node->actions[0][j];
+            if (action_info.n_visits + action_info.n_virtual_losses < min_n_visits) {
+                min_n_visits = action_info.n_visits + action_info.n_virtual_losses;
+                min_idx = j;
             }
         }
-        return {action};
-    }
-    std::vector<Action> joint_action;
-    joint_action.reserve(node->actions.size());
-    for (int i = 0; i < node->actions.size(); ++i) {
-        const auto& action_infos = node->actions[i];
-        int total_visits = node->n_visits;
-        double log_total = std::log(std::max(1, total_visits));
-        double best_score = -std::numeric_limits<double>::infinity();
-        int best_idx = -1;
-        for (int j = 0; j < action_infos.size(); ++j) {
-            if (action_infos[j].n_visits == 0) {
-                best_idx = j;
-                break;
-            }
-            double ucb1_score = (action_infos[j].sum_results / action_infos[j].n_visits) + sqrt(2 * log_total / action_infos[j].n_visits);
-            if (ucb1_score > best_score) {
-                best_score = ucb1_score;
-                best_idx = j;
+        action_ids.push_back(min_idx);
+    } else {
+        for (std::size_t i = 0; i < node->actions.size(); ++i) {
+            const auto& action_infos = node->actions[i];
+            int total_visits = node->n_visits + node->n_virtual_losses;
+            double log_total = std::log(std::max(1, total_visits));
+            double best_score = -std::numeric_limits<double>::infinity();
+            int best_idx = -1;
+            for (int j = 0; j < static_cast<int>(action_infos.size()); ++j) {
+                const int n_visits = action_infos[j].n_visits + action_infos[j].n_virtual_losses;
+                if (n_visits == 0) {
+                    best_idx = j;
+                    break;
+                }
+                double ucb1_score = (action_infos[j].sum_results / n_visits) + sqrt(2 * log_total / n_visits);
+                if (ucb1_score > best_score) {
+                    best_score = ucb1_score;
+                    best_idx = j;
+                }
             }
+            action_ids.push_back(best_idx);
         }
-        joint_action.push_back(action_infos[best_idx].action);
     }
-    return joint_action;
+    node->n_virtual_losses += virtual_loss;
+    const double loss_results = virtual_loss * virtual_loss_value();
+    for (std::size_t i = 0; i < action_ids.size(); ++i) {
+        auto& info = node->actions[i][action_ids[i]];
+        info.n_virtual_losses += virtual_loss;
+        info.sum_results += loss_results;
+    }
+    return action_ids;
 }
 
-NodeUCT* DeterminizedUCT::select_and_expand(NodeUCT* node) {
+double DeterminizedUCT::virtual_loss_value() const {
+    return virtual_loss_value_.value_or(game_->min_return());
+}
+
+NodeUCT* DeterminizedUCT::select_and_expand(NodeUCT* node, std::vector<PathStep>& path, std::vector<Action>& frontier_action, SearchContext& context, std::mt19937& generator) {
+    // Locking is only needed when other threads search the tree
+    auto lock_if_shared = [&](std::mutex& mutex) {
+        return context.shared ? std::unique_lock<std::mutex>(mutex) : std::unique_lock<std::mutex>();
+    };
     while (!game_->is_terminal(node->state)) {
-        std::vector<Action> joint_action = select_joint_action(node);
+        std::unique_lock<std::mutex> node_lock = lock_if_shared(node->mutex);
+        std::vector<int> action_ids = select_action_ids(node, context.shared ? virtual_loss_ : 0);
+        std::vector<Action> joint_action;
+        joint_action.reserve(action_ids.size());
+        for (std::size_t i = 0; i < action_ids.size(); ++i) {
+            joint_action.push_back(node->actions[i][action_ids[i]].action);
+        }
         auto it = std::find_if(
             node->successors.begin(), node->successors.end(),
             [&](const NodeUCT::SuccessorInfo& s) { return s.joint_action == joint_action; }
         );
-        if (it == node->successors.end()) {
-            // No successor yet — create the leaf and return it;
-            State new_state(node->state);
-            game_->apply_joint_action_inplace(new_state, joint_action, generator_);
-            node->successors.push_back({
-                .joint_action = joint_action,
-                .successor = std::make_unique<NodeUCT>(game_, new_state, node, joint_action)
-            });
-            node = node->successors.back().successor.get();
+        if (it != node->successors.end()) {
+            NodeUCT* successor = it->successor;
+            path.push_back({node, std::move(action_ids)});
+            // A transposition may close a cycle, which the selection must not follow
+            if (transpositions_.enabled && std::ranges::any_of(path, [&](const PathStep& step) { return step.node == successor; })) {
+                frontier_action = std::move(joint_action);
+                return node;
+            }
+            node = successor;
+            continue;
+        }
+        {
+            std::unique_lock<std::mutex> context_lock = lock_if_shared(context.mutex);
+            if (transpositions_.enabled && context.nodes.size() >= transpositions_.max_nodes) {
+                path.push_back({node, std::move(action_ids)});
+                frontier_action = std::move(joint_action);
+                return node;
+            }
+        }
+        State new_state(node->state);
+        game_->apply_joint_action_inplace(new_state, joint_action, generator);
+        NodeUCT* successor = nullptr;
+        if (transpositions_.enabled) {
+            std::unique_lock<std::mutex> context_lock = lock_if_shared(context.mutex);
+            successor = context.transposition_table.find(new_state);
+        }
+        path.push_back({node, std::move(action_ids)});
+        if (std::ranges::any_of(path, [&](const PathStep& step) { return step.node == successor; })) {
+            successor = nullptr;
+        }
+        const bool transposition = successor != nullptr;
+        if (!transposition) {
+            successor = new_node(std::move(new_state), context);
+        }
+        node->successors.push_back({
+            .joint_action = std::move(joint_action),
+            .successor = successor
+        });
+        node = successor;
+        // A new leaf is simulated, a known node is searched further
+        if (!transposition) {
             break;
         }
-        node = it->successor.get();
     }
     return node;
 }
 
-std::vector<double> DeterminizedUCT::simulate(NodeUCT* node) {
-    State current_state(node->state);
+NodeUCT* DeterminizedUCT::new_node(State state, SearchContext& context) {
+    NodeUCT* node = context.make_node(game_, std::move(state));
+    std::unique_lock<std::mutex> lock = context.shared ? std::unique_lock<std::mutex>(context.mutex) : std::unique_lock<std::mutex>();
+    context.nodes.push_back(node);
+    if (transpositions_.enabled) {
+        context.transposition_table.store(node);
+    }
+    return node;
+}
+
+std::vector<double> DeterminizedUCT::simulate(NodeUCT* node, const std::vector<Action>& frontier_action, SearchContext& context, std::mt19937& generator) {
+    // The playout runs on the node's state and is undone afterwards, unless other threads may be
+    // reading that state
+    std::optional<State> state_copy;
+    if (context.shared) {
+        state_copy.emplace(node->state);
+    }
+    State& current_state = context.shared ? *state_copy : node->state;
+    State::Checkpoint checkpoint = current_state.checkpoint();
+    if (!frontier_action.empty()) {
+        game_->apply_joint_action_inplace(current_state, frontier_action, generator);
+    }
     int playout_iter = 0;
     while (!game_->is_terminal(current_state) && playout_iter < 200) {
         const auto& current_players = current_state.current_players();
-        std::vector<Action> joint_action(current_players.size());
+        std::vector<Action> joint_action;
+        joint_action.reserve(current_players.size());
         for (PlayerId player_id : current_players) {
             std::vector<ProbAction> prob_actions = game_->legal_actions(current_state, player_id);
             std::uniform_int_distribution<int> distribution(0, static_cast<int>(prob_actions.size()) - 1);
-            joint_action.push_back(prob_actions[distribution(generator_)].action);
+            joint_action.push_back(prob_actions[distribution(generator)].action);
         }
-        game_->apply_joint_action_inplace(current_state, joint_action, generator_);
+        game_->apply_joint_action_inplace(current_state, joint_action, generator);
         playout_iter++;
     }
-    return game_->returns(current_state);
-}
-
-void DeterminizedUCT::backpropagate(NodeUCT* node, const std::vector<double>& result) {
-    while (node != nullptr) {
-        node->n_visits++;
-        const auto& joint_action = node->parent_joint_action;
-        if (joint_action.has_value() && node->parent_node != nullptr) {
-            const std::vector<Action>& ja = joint_action.value();
-            auto& parent_actions = node->parent_node->actions;
-            const std::vector<PlayerId>& parent_players = node->parent_node->state.current_players();
-            for (int i = 0; i < ja.size(); ++i) {
-                for (auto& info : parent_actions[i]) {
-                    if (info.action == ja[i]) {
-                        info.n_visits++;
-                        info.sum_results += result[parent_players[i]];
-                        break;
-                    }
-                }
+    std::vector<double> returns = game_->returns(current_state);
+    current_state.rollback(checkpoint);
+    return returns;
+}
+
+void DeterminizedUCT::backpropagate(const std::vector<PathStep>& path, NodeUCT* leaf, const std::vector<double>& result, int virtual_loss) {
+    // The statistics of the edges are stored in the node they leave, so that a node shared by
+    // several parents only updates the edge of the path that was actually followed
+    if (path.empty() || path.back().node != leaf) {
+        leaf->n_visits++;
+    }
+    for (const PathStep& step : path) {
+        std::lock_guard<std::mutex> lock(step.node->mutex);
+        step.node->n_visits++;
+        step.node->n_virtual_losses -= virtual_loss;
+        const std::vector<PlayerId>& players = step.node->state.current_players();
+        const double loss_results = virtual_loss * virtual_loss_value();
+        for (std::size_t i = 0; i < step.action_ids.size(); ++i) {
+            auto& info = step.node->actions[i][step.action_ids[i]];
+            info.n_visits++;
+            info.n_virtual_losses -= virtual_loss;
+            info.sum_results -= loss_results;
+            if (players[i] != kChancePlayerId) {
+                info.sum_results += result[players[i]];
             }
         }
-        node = node->parent_node;
     }
 }
 
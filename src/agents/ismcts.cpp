@@ -0,0 +1,264 @@
+#include "Belief-SG/agents/ismcts.h"
+
+#include "Belief-SG/core/action.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/seeding.h"
+#include "Belief-SG/core/state.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace belief_sg {
+
+NodeISMCTS::NodeISMCTS(State node_state, std::pmr::memory_resource* memory)
+    : state(std::move(node_state)), actions(memory), successors(memory) {}
+
+std::vector<int> NodeISMCTS::add_available_actions(int player_index, const std::vector<ProbAction>& legal_actions) {
+    // The current players are part of the information set, every determinization has the same
+    if (actions.empty()) {
+        actions.resize(state.current_players().size());
+    }
+    auto& action_infos = actions[player_index];
+    std::vector<int> available_ids;
+    available_ids.reserve(legal_actions.size());
+    for (const ProbAction& prob_action : legal_actions) {
+        auto it = std::ranges::find(action_infos, prob_action.action, &ActionInfo::action);
+        if (it == action_infos.end()) {
+            action_infos.push_back({.action = prob_action.action, .n_visits = 0, .sum_results = 0.0, .n_available = 0});
+            it = std::prev(action_infos.end());
+        }
+        it->n_available++;
+        available_ids.push_back(static_cast<int>(std::distance(action_infos.begin(), it)));
+    }
+    return available_ids;
+}
+
+int NodeISMCTS::select_action(int player_index, const std::vector<int>& available_ids) const {
+    const auto& action_infos = actions[player_index];
+    double best_score = -std::numeric_limits<double>::infinity();
+    int best_idx = -1;
+    for (int j : available_ids) {
+        const auto& action_info = action_infos[j];
+        if (action_info.n_visits == 0) {
+            return j;
+        }
+        // An action is only compared with the others in the visits where it was available
+        double ucb1_score = (action_info.sum_results / action_info.n_visits) + sqrt(2 * std::log(action_info.n_available) / action_info.n_visits);
+        if (ucb1_score > best_score) {
+            best_score = ucb1_score;
+            best_idx = j;
+        }
+    }
+    return best_idx;
+}
+
+ISMCTS::ISMCTS() : ISMCTS(10000, false) {}
+
+ISMCTS::ISMCTS(int n_iterations, bool use_prob)
+    : generator_(make_generator(random_seed())),
+      n_iterations_(n_iterations),
+      use_prob_(use_prob) {}
+
+ISMCTS::~ISMCTS() {
+    clear_tree();
+}
+
+void ISMCTS::set_game(std::shared_ptr<Game> game) {
+    game_ = game;
+}
+
+void ISMCTS::set_player(PlayerId player) {
+    player_ = player;
+}
+
+void ISMCTS::set_seed(std::uint64_t seed) {
+    generator_ = make_generator(seed);
+}
+
+void ISMCTS::set_time_budget(std::chrono::milliseconds time_budget) {
+    if (time_budget.count() < 0) {
+        throw std::invalid_argument("The time budget cannot be negative");
+    }
+    time_budget_ = time_budget;
+}
+
+Action ISMCTS::act(const State& private_state, const State& public_state) {
+    const auto deadline = time_budget_.count() == 0
+        ? std::chrono::steady_clock::time_point::max()
+        : std::chrono::steady_clock::now() + time_budget_;
+
+    std::vector<ProbAction> actions = game_->legal_actions(private_state, player_);
+    if (actions.size() == 1) {
+        return actions[0].action;
+    }
+
+    root_ = std::pmr::polymorphic_allocator<NodeISMCTS>(&arena_).new_object<NodeISMCTS>(private_state, &arena_);
+    n_playouts_ = 0;
+    // The first iteration always runs, so that the root has statistics
+    do {
+        run_iteration(root_, private_state);
+        n_playouts_++;
+    } while (time_budget_.count() == 0
+        ? n_playouts_ < n_iterations_
+        : std::chrono::steady_clock::now() < deadline);
+
+    const std::vector<PlayerId>& current_players = root_->state.current_players();
+    auto it = std::ranges::find(current_players, player_);
+    if (it == current_players.end()) {
+        throw std::runtime_error("Player not found in current players");
+    }
+    const std::size_t action_id = std::distance(current_players.begin(), it);
+    Action max_action = actions[0].action;
+    int max_visits = -1;
+    for (const auto& action_info : root_->actions[action_id]) {
+        if (action_info.n_visits > max_visits) {
+            max_action = action_info.action;
+            max_visits = action_info.n_visits;
+        }
+    }
+
+    n_nodes_ = nodes_.size();
+    clear_tree();
+    return max_action;
+}
+
+std::size_t ISMCTS::n_nodes() const {
+    return n_nodes_;
+}
+
+int ISMCTS::n_playouts() const {
+    return n_playouts_;
+}
+
+void ISMCTS::run_iteration(NodeISMCTS* root, const State& private_state) {
+    State state(private_state);
+    if (use_prob_) {
+        state.determinize_with_marginals(generator_);
+    } else {
+        // The probability of the determinization would cost a belief propagation per piece
+        state.determinize(generator_, false);
+    }
+
+    std::vector<PathStep> path;
+    NodeISMCTS* node = root;
+    while (!game_->is_terminal(state)) {
+        std::vector<int> action_ids = select_action_ids(node, state);
+        std::vector<Action> joint_action;
+        joint_action.reserve(action_ids.size());
+        for (std::size_t i = 0; i < action_ids.size(); ++i) {
+            joint_action.push_back(node->actions[i][action_ids[i]].action);
+        }
+        path.push_back({node, std::move(action_ids)});
+        game_->apply_joint_action_inplace(state, joint_action, generator_);
+        NodeISMCTS* successor = find_successor(node, joint_action, state);
+        if (successor == nullptr) {
+            // A new leaf is simulated
+            node = new_successor(node, std::move(joint_action), state);
+            break;
+        }
+        node = successor;
+    }
+
+    std::vector<double> result = simulate(state);
+    backpropagate(path, node, result);
+}
+
+std::vector<int> ISMCTS::select_action_ids(NodeISMCTS* node, const State& state) {
+    const std::vector<PlayerId>& current_players = state.current_players();
+    std::vector<int> action_ids;
+    action_ids.reserve(current_players.size());
+    for (int i = 0; i < static_cast<int>(current_players.size()); ++i) {
+        std::vector<int> available_ids = node->add_available_actions(i, game_->legal_actions(state, current_players[i]));
+        if (current_players[i] == kChancePlayerId) {
+            // Chance plays as in the game
+            std::uniform_int_distribution<int> distribution(0, static_cast<int>(available_ids.size()) - 1);
+            action_ids.push_back(available_ids[distribution(generator_)]);
+        } else {
+            action_ids.push_back(node->select_action(i, available_ids));
+        }
+    }
+    return action_ids;
+}
+
+NodeISMCTS* ISMCTS::find_successor(NodeISMCTS* node, const std::vector<Action>& joint_action, const State& state) const {
+    for (const NodeISMCTS::SuccessorInfo& successor_info : node->successors) {
+        if (successor_info.joint_action == joint_action && successor_info.successor->state.is_consistent_with(state)) {
+            return successor_info.successor;
+        }
+    }
+    return nullptr;
+}
+
+NodeISMCTS* ISMCTS::new_successor(NodeISMCTS* node, std::vector<Action> joint_action, const State& state) {
+    // The agent observes the outcome of the joint action that the determinization went through,
+    // as the manager does when it updates the private states
+    std::optional<State> successor_state = game_->consistent_transition(node->state, joint_action, state);
+    if (!successor_state.has_value()) {
+        throw std::runtime_error("No information set is consistent with the determinization");
+    }
+    NodeISMCTS* successor = std::pmr::polymorphic_allocator<NodeISMCTS>(&arena_).new_object<NodeISMCTS>(std::move(*successor_state), &arena_);
+    nodes_.push_back(successor);
+    node->successors.push_back({
+        .joint_action = std::move(joint_action),
+        .successor = successor
+    });
+    return successor;
+}
+
+std::vector<double> ISMCTS::simulate(State& state) {
+    // The determinization is discarded after the iteration, the playout runs on it directly
+    int playout_iter = 0;
+    while (!game_->is_terminal(state) && playout_iter < 200) {
+        const auto& current_players = state.current_players();
+        std::vector<Action> joint_action;
+        joint_action.reserve(current_players.size());
+        for (PlayerId player_id : current_players) {
+            std::vector<ProbAction> prob_actions = game_->legal_actions(state, player_id);
+            std::uniform_int_distribution<int> distribution(0, static_cast<int>(prob_actions.size()) - 1);
+            joint_action.push_back(prob_actions[distribution(generator_)].action);
+        }
+        game_->apply_joint_action_inplace(state, joint_action, generator_);
+        playout_iter++;
+    }
+    return game_->returns(state);
+}
+
+void ISMCTS::backpropagate(const std::vector<PathStep>& path, NodeISMCTS* leaf, const std::vector<double>& result) {
+    leaf->n_visits++;
+    for (const PathStep& step : path) {
+        step.node->n_visits++;
+        const std::vector<PlayerId>& players = step.node->state.current_players();
+        for (std::size_t i = 0; i < step.action_ids.size(); ++i) {
+            auto& info = step.node->actions[i][step.action_ids[i]];
+            info.n_visits++;
+            if (players[i] != kChancePlayerId) {
+                info.sum_results += result[players[i]];
+            }
+        }
+    }
+}
+
+void ISMCTS::clear_tree() {
+    // The nodes own states and actions outside of the arena
+    for (NodeISMCTS* node : nodes_) {
+        node->~NodeISMCTS();
+    }
+    nodes_.clear();
+    if (root_ != nullptr) {
+        root_->~NodeISMCTS();
+        root_ = nullptr;
+    }
+    arena_.release();
+}
+
+}  // namespace belief_sg
@@ -0,0 +1,237 @@
+#include "Belief-SG/agents/mo_ismcts.h"
+
+#include "Belief-SG/core/action.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/seeding.h"
+#include "Belief-SG/core/state.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace belief_sg {
+
+MOISMCTS::MOISMCTS() : MOISMCTS(10000, false) {}
+
+MOISMCTS::MOISMCTS(int n_iterations, bool use_prob)
+    : generator_(make_generator(random_seed())),
+      n_iterations_(n_iterations),
+      use_prob_(use_prob) {}
+
+MOISMCTS::~MOISMCTS() {
+    clear_trees();
+}
+
+void MOISMCTS::set_game(std::shared_ptr<Game> game) {
+    game_ = game;
+}
+
+void MOISMCTS::set_player(PlayerId player) {
+    player_ = player;
+}
+
+void MOISMCTS::set_seed(std::uint64_t seed) {
+    generator_ = make_generator(seed);
+}
+
+void MOISMCTS::set_time_budget(std::chrono::milliseconds time_budget) {
+    if (time_budget.count() < 0) {
+        throw std::invalid_argument("The time budget cannot be negative");
+    }
+    time_budget_ = time_budget;
+}
+
+Action MOISMCTS::act(const State& private_state, const State& public_state) {
+    const auto deadline = time_budget_.count() == 0
+        ? std::chrono::steady_clock::time_point::max()
+        : std::chrono::steady_clock::now() + time_budget_;
+
+    std::vector<ProbAction> actions = game_->legal_actions(private_state, player_);
+    if (actions.size() == 1) {
+        return actions[0].action;
+    }
+
+    // The agent only knows the public part of the information sets of the other players
+    for (PlayerId player_id = 0; player_id < game_->num_players(); ++player_id) {
+        State root_state = player_id == player_ ? private_state : public_state.private_view(player_id);
+        roots_.push_back(std::pmr::polymorphic_allocator<NodeISMCTS>(&arena_).new_object<NodeISMCTS>(std::move(root_state), &arena_));
+    }
+    n_playouts_ = 0;
+    // The first iteration always runs, so that the root has statistics
+    do {
+        run_iteration(private_state);
+        n_playouts_++;
+    } while (time_budget_.count() == 0
+        ? n_playouts_ < n_iterations_
+        : std::chrono::steady_clock::now() < deadline);
+
+    const NodeISMCTS* root = roots_[player_];
+    const std::vector<PlayerId>& current_players = root->state.current_players();
+    auto it = std::ranges::find(current_players, player_);
+    if (it == current_players.end()) {
+        throw std::runtime_error("Player not found in current players");
+    }
+    const std::size_t action_id = std::distance(current_players.begin(), it);
+    Action max_action = actions[0].action;
+    int max_visits = -1;
+    for (const auto& action_info : root->actions[action_id]) {
+        if (action_info.n_visits > max_visits) {
+            max_action = action_info.action;
+            max_visits = action_info.n_visits;
+        }
+    }
+
+    n_nodes_ = nodes_.size();
+    clear_trees();
+    return max_action;
+}
+
+std::size_t MOISMCTS::n_nodes() const {
+    return n_nodes_;
+}
+
+int MOISMCTS::n_playouts() const {
+    return n_playouts_;
+}
+
+void MOISMCTS::run_iteration(const State& private_state) {
+    State state(private_state);
+    if (use_prob_) {
+        state.determinize_with_marginals(generator_);
+    } else {
+        // The probability of the determinization would cost a belief propagation per piece
+        state.determinize(generator_, false);
+    }
+
+    std::vector<NodeISMCTS*> nodes(roots_);
+    std::vector<std::vector<PathStep>> paths(nodes.size());
+    while (!game_->is_terminal(state)) {
+        const std::vector<PlayerId> current_players = state.current_players();
+        std::vector<Action> joint_action;
+        joint_action.reserve(current_players.size());
+        for (PlayerId player_id = 0; player_id < static_cast<PlayerId>(paths.size()); ++player_id) {
+            paths[player_id].push_back({.node = nodes[player_id], .player_index = -1, .action_id = -1});
+        }
+        for (int i = 0; i < static_cast<int>(current_players.size()); ++i) {
+            std::vector<ProbAction> legal_actions = game_->legal_actions(state, current_players[i]);
+            if (current_players[i] == kChancePlayerId) {
+                // Chance plays as in the game
+                std::uniform_int_distribution<int> distribution(0, static_cast<int>(legal_actions.size()) - 1);
+                joint_action.push_back(legal_actions[distribution(generator_)].action);
+                continue;
+            }
+            // Each player selects in its own tree
+            NodeISMCTS* node = nodes[current_players[i]];
+            const int action_id = node->select_action(i, node->add_available_actions(i, legal_actions));
+            paths[current_players[i]].back().player_index = i;
+            paths[current_players[i]].back().action_id = action_id;
+            joint_action.push_back(node->actions[i][action_id].action);
+        }
+        game_->apply_joint_action_inplace(state, joint_action, generator_);
+
+        // Every tree grows by at most one node per iteration: once one of them reaches a new
+        // information set, the new leaves are simulated
+        bool expanded = false;
+        for (NodeISMCTS*& node : nodes) {
+            State new_state;
+            NodeISMCTS* successor = find_successor(node, joint_action, state, new_state);
+            if (successor == nullptr) {
+                successor = new_node(std::move(new_state));
+                node->successors.push_back({
+                    .joint_action = joint_action,
+                    .successor = successor
+                });
+                expanded = true;
+            }
+            node = successor;
+        }
+        if (expanded) {
+            break;
+        }
+    }
+
+    std::vector<double> result = simulate(state);
+    for (PlayerId player_id = 0; player_id < static_cast<PlayerId>(paths.size()); ++player_id) {
+        nodes[player_id]->n_visits++;
+        for (const PathStep& step : paths[player_id]) {
+            step.node->n_visits++;
+            if (step.action_id >= 0) {
+                auto& info = step.node->actions[step.player_index][step.action_id];
+                info.n_visits++;
+                info.sum_results += result[player_id];
+            }
+        }
+    }
+}
+
+NodeISMCTS* MOISMCTS::find_successor(NodeISMCTS* node, const std::vector<Action>& joint_action, const State& state, State& new_state) {
+    for (const NodeISMCTS::SuccessorInfo& successor_info : node->successors) {
+        if (successor_info.joint_action == joint_action && successor_info.successor->state.is_consistent_with(state)) {
+            return successor_info.successor;
+        }
+    }
+    // The player observes the outcome of the joint action that the determinization went
+    // through, as the manager does when it updates the private states
+    std::optional<State> successor_state = game_->consistent_transition(node->state, joint_action, state);
+    if (!successor_state.has_value()) {
+        throw std::runtime_error("No information set is consistent with the determinization");
+    }
+    for (std::size_t i = 0; i < node->successors.size(); ++i) {
+        NodeISMCTS* successor = node->successors[i].successor;
+        if (successor->state == *successor_state) {
+            node->successors.push_back({
+                .joint_action = joint_action,
+                .successor = successor
+            });
+            return successor;
+        }
+    }
+    new_state = std::move(*successor_state);
+    return nullptr;
+}
+
+NodeISMCTS* MOISMCTS::new_node(State state) {
+    NodeISMCTS* node = std::pmr::polymorphic_allocator<NodeISMCTS>(&arena_).new_object<NodeISMCTS>(std::move(state), &arena_);
+    nodes_.push_back(node);
+    return node;
+}
+
+std::vector<double> MOISMCTS::simulate(State& state) {
+    // The determinization is discarded after the iteration, the playout runs on it directly
+    int playout_iter = 0;
+    while (!game_->is_terminal(state) && playout_iter < 200) {
+        const auto& current_players = state.current_players();
+        std::vector<Action> joint_action;
+        joint_action.reserve(current_players.size());
+        for (PlayerId player_id : current_players) {
+            std::vector<ProbAction> prob_actions = game_->legal_actions(state, player_id);
+            std::uniform_int_distribution<int> distribution(0, static_cast<int>(prob_actions.size()) - 1);
+            joint_action.push_back(prob_actions[distribution(generator_)].action);
+        }
+        game_->apply_joint_action_inplace(state, joint_action, generator_);
+        playout_iter++;
+    }
+    return game_->returns(state);
+}
+
+void MOISMCTS::clear_trees() {
+    // The nodes own states and actions outside of the arena
+    for (NodeISMCTS* node : nodes_) {
+        node->~NodeISMCTS();
+    }
+    nodes_.clear();
+    for (NodeISMCTS* root : roots_) {
+        root->~NodeISMCTS();
+    }
+    roots_.clear();
+    arena_.release();
+}
+
+}  // namespace belief_sg
@@ -1,10 +1,13 @@
 #include "Belief-SG/agents/random_agent.h"
 
+#include <cstdint>
 #include <iostream>
 
+#include "Belief-SG/core/seeding.h"
+
 namespace belief_sg {
 
-RandomAgent::RandomAgent() : generator_(std::random_device()()) {}
+RandomAgent::RandomAgent() : generator_(make_generator(random_seed())) {}
 
 void RandomAgent::set_game(std::shared_ptr<Game> game) {
   game_ = std::move(game);
@@ -14,6 +17,10 @@ void RandomAgent::set_player(PlayerId player) {
   player_ = player;
 }
 
+void RandomAgent::set_seed(std::uint64_t seed) {
+  generator_ = make_generator(seed);
+}
+
 Action RandomAgent::act(const State& private_state, const State& public_state) {
   std::vector<ProbAction> actions = game_->legal_actions(private_state, player_);
 
@@ -1,5 +1,11 @@
 #include "Belief-SG/core/action.h"
 
+#include <cstddef>
+#include <utility>
+
+#include "Belief-SG/core/observation.h"
+#include "Belief-SG/core/prob_transition.h"
+
 namespace belief_sg {
 
 Action::Action(std::vector<std::unique_ptr<Move>> moves) : moves_(std::move(moves)) {}
@@ -34,18 +40,24 @@ bool Action::operator==(const Action& other) const {
 }
 
 std::vector<ProbTransition> Action::apply(const State& state) const {
-    std::vector<ProbTransition> transitions;
-    transitions.push_back(ProbTransition({state, 1.0}));
-    for (const auto& move : moves_) {
-        std::vector<ProbTransition> new_transitions;
-        for (const auto& transition : transitions) {
-            for (const auto& new_transition : move->apply(transition.state)) {
-                new_transitions.push_back(ProbTransition({new_transition.state, new_transition.probability * transition.probability}));
-            }
+    return transitions(state).to_vector();
+}
+
+TransitionStream Action::transitions(const State& state) const {
+    return transitions_from(state, 0, 1.0);
+}
+
+TransitionStream Action::transitions_from(State state, std::size_t move_id, double probability) const {
+    if (move_id == moves_.size()) {
+        ProbTransition transition{std::move(state), probability};
+        co_yield std::move(transition);
+        co_return;
+    }
+    for (ProbTransition& transition : moves_[move_id]->transitions(state)) {
+        for (ProbTransition& new_transition : transitions_from(std::move(transition.state), move_id + 1, probability * transition.probability)) {
+            co_yield std::move(new_transition);
         }
-        transitions = new_transitions;
     }
-    return transitions;
 }
 
 void Action::apply_inplace(State& state, std::mt19937& generator) const {
@@ -54,4 +66,16 @@ void Action::apply_inplace(State& state, std::mt19937& generator) const {
     }
 }
 
+void Action::apply_inplace_observed(State& state, std::mt19937& generator, Observation& observation) const {
+    for (const auto& move : moves_) {
+        move->apply_inplace_observed(state, generator, observation);
+    }
+}
+
+void Action::apply_observation(State& state, const Observation& observation, std::size_t& draw_id) const {
+    for (const auto& move : moves_) {
+        move->apply_observation(state, observation, draw_id);
+    }
+}
+
 }  // namespace belief_sg
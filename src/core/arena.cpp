@@ -0,0 +1,68 @@
+#include "Belief-SG/core/arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace belief_sg {
+
+Arena::Arena(bool synchronized, std::size_t block_size) : synchronized_(synchronized), block_size_(block_size) {}
+
+Arena::~Arena() {
+    release();
+}
+
+void Arena::release() {
+    for (const Block& block : blocks_) {
+        ::operator delete(block.data, std::align_val_t(alignof(std::max_align_t)));
+    }
+    blocks_.clear();
+    current_ = nullptr;
+    end_ = nullptr;
+    bytes_used_ = 0;
+    bytes_reserved_ = 0;
+}
+
+std::size_t Arena::bytes_used() const {
+    return bytes_used_;
+}
+
+std::size_t Arena::bytes_reserved() const {
+    return bytes_reserved_;
+}
+
+void* Arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    std::unique_lock<std::mutex> lock = synchronized_ ? std::unique_lock<std::mutex>(mutex_) : std::unique_lock<std::mutex>();
+    auto align = [alignment](std::byte* pointer) {
+        const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+        return reinterpret_cast<std::byte*>((address + alignment - 1) & ~(alignment - 1));
+    };
+    std::byte* start = current_ == nullptr ? nullptr : align(current_);
+    if (current_ == nullptr || start + bytes > end_) {
+        const std::size_t size = std::max(block_size_, bytes + alignment);
+        auto* data = static_cast<std::byte*>(::operator new(size, std::align_val_t(alignof(std::max_align_t))));
+        blocks_.push_back({data, size});
+        bytes_reserved_ += size;
+        start = align(data);
+        if (size > block_size_) {
+            // Oversized requests get a block of their own, the current block stays in use
+            bytes_used_ += bytes;
+            return start;
+        }
+        current_ = data;
+        end_ = data + size;
+    }
+    bytes_used_ += static_cast<std::size_t>(start - current_) + bytes;
+    current_ = start + bytes;
+    return start;
+}
+
+void Arena::do_deallocate(void* /*pointer*/, std::size_t /*bytes*/, std::size_t /*alignment*/) {}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+}  // namespace belief_sg
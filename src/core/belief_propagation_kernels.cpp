@@ -0,0 +1,380 @@
+#include "Belief-SG/core/belief_propagation_kernels.h"
+
+#include <cstdlib>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BELIEF_SG_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace belief_sg {
+
+namespace {
+
+double scalar_masked_sum(const double* values, const double* mask, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        if (mask[i] > 0.0) {
+            sum += values[i];
+        }
+    }
+    return sum;
+}
+
+double scalar_dot(const double* x, const double* y, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+void scalar_axpby(double a, const double* x, double b, const double* y, double* out, int n) {
+    for (int i = 0; i < n; i++) {
+        out[i] = a * x[i] + b * y[i];
+    }
+}
+
+void scalar_masked_copy(double* out, const double* values, const double* mask, int n) {
+    for (int i = 0; i < n; i++) {
+        if (mask[i] > 0.0) {
+            out[i] = values[i];
+        }
+    }
+}
+
+void scalar_masked_multiply(double* out, const double* factors, const double* mask, int n) {
+    for (int i = 0; i < n; i++) {
+        if (mask[i] > 0.0) {
+            out[i] *= factors[i];
+        }
+    }
+}
+
+void scalar_masked_damped_divide(double* out, const double* numerators, const double* denominators, const double* mask, double damping, int n) {
+    for (int i = 0; i < n; i++) {
+        if (mask[i] > 0.0) {
+            double ratio = denominators[i] > 0.0 ? numerators[i] / denominators[i] : 0.0;
+            out[i] = damping * ratio + (1.0 - damping) * out[i];
+        }
+    }
+}
+
+void scalar_normalize(double* out, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += out[i];
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] /= sum;
+    }
+}
+
+#ifdef BELIEF_SG_X86_KERNELS
+
+// ---------------- AVX2 ----------------
+
+__attribute__((target("avx2,fma"))) double horizontal_sum(__m256d v) {
+    __m128d low = _mm256_castpd256_pd128(v);
+    __m128d high = _mm256_extractf128_pd(v, 1);
+    low = _mm_add_pd(low, high);
+    __m128d swapped = _mm_unpackhi_pd(low, low);
+    return _mm_cvtsd_f64(_mm_add_sd(low, swapped));
+}
+
+__attribute__((target("avx2,fma"))) double avx2_masked_sum(const double* values, const double* mask, int n) {
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d sum = zero;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d keep = _mm256_cmp_pd(_mm256_loadu_pd(mask + i), zero, _CMP_GT_OQ);
+        sum = _mm256_add_pd(sum, _mm256_and_pd(_mm256_loadu_pd(values + i), keep));
+    }
+    double result = horizontal_sum(sum);
+    for (; i < n; i++) {
+        if (mask[i] > 0.0) {
+            result += values[i];
+        }
+    }
+    return result;
+}
+
+__attribute__((target("avx2,fma"))) double avx2_dot(const double* x, const double* y, int n) {
+    __m256d sum = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sum = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), sum);
+    }
+    double result = horizontal_sum(sum);
+    for (; i < n; i++) {
+        result += x[i] * y[i];
+    }
+    return result;
+}
+
+__attribute__((target("avx2,fma"))) void avx2_axpby(double a, const double* x, double b, const double* y, double* out, int n) {
+    const __m256d va = _mm256_set1_pd(a);
+    const __m256d vb = _mm256_set1_pd(b);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d result = _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_mul_pd(vb, _mm256_loadu_pd(y + i)));
+        _mm256_storeu_pd(out + i, result);
+    }
+    for (; i < n; i++) {
+        out[i] = a * x[i] + b * y[i];
+    }
+}
+
+__attribute__((target("avx2,fma"))) void avx2_masked_copy(double* out, const double* values, const double* mask, int n) {
+    const __m256d zero = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d keep = _mm256_cmp_pd(_mm256_loadu_pd(mask + i), zero, _CMP_GT_OQ);
+        _mm256_storeu_pd(out + i, _mm256_blendv_pd(_mm256_loadu_pd(out + i), _mm256_loadu_pd(values + i), keep));
+    }
+    for (; i < n; i++) {
+        if (mask[i] > 0.0) {
+            out[i] = values[i];
+        }
+    }
+}
+
+__attribute__((target("avx2,fma"))) void avx2_masked_multiply(double* out, const double* factors, const double* mask, int n) {
+    const __m256d zero = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d keep = _mm256_cmp_pd(_mm256_loadu_pd(mask + i), zero, _CMP_GT_OQ);
+        __m256d current = _mm256_loadu_pd(out + i);
+        __m256d product = _mm256_mul_pd(current, _mm256_loadu_pd(factors + i));
+        _mm256_storeu_pd(out + i, _mm256_blendv_pd(current, product, keep));
+    }
+    for (; i < n; i++) {
+        if (mask[i] > 0.0) {
+            out[i] *= factors[i];
+        }
+    }
+}
+
+__attribute__((target("avx2,fma"))) void avx2_masked_damped_divide(double* out, const double* numerators, const double* denominators, const double* mask, double damping, int n) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d new_weight = _mm256_set1_pd(damping);
+    const __m256d old_weight = _mm256_set1_pd(1.0 - damping);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d keep = _mm256_cmp_pd(_mm256_loadu_pd(mask + i), zero, _CMP_GT_OQ);
+        __m256d current = _mm256_loadu_pd(out + i);
+        __m256d denominator = _mm256_loadu_pd(denominators + i);
+        __m256d ratio = _mm256_and_pd(_mm256_div_pd(_mm256_loadu_pd(numerators + i), denominator), _mm256_cmp_pd(denominator, zero, _CMP_GT_OQ));
+        __m256d updated = _mm256_fmadd_pd(new_weight, ratio, _mm256_mul_pd(old_weight, current));
+        _mm256_storeu_pd(out + i, _mm256_blendv_pd(current, updated, keep));
+    }
+    for (; i < n; i++) {
+        if (mask[i] > 0.0) {
+            double ratio = denominators[i] > 0.0 ? numerators[i] / denominators[i] : 0.0;
+            out[i] = damping * ratio + (1.0 - damping) * out[i];
+        }
+    }
+}
+
+__attribute__((target("avx2,fma"))) void avx2_normalize(double* out, int n) {
+    __m256d sum = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sum = _mm256_add_pd(sum, _mm256_loadu_pd(out + i));
+    }
+    double total = horizontal_sum(sum);
+    for (; i < n; i++) {
+        total += out[i];
+    }
+    const __m256d divisor = _mm256_set1_pd(total);
+    i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_loadu_pd(out + i), divisor));
+    }
+    for (; i < n; i++) {
+        out[i] /= total;
+    }
+}
+
+// ---------------- AVX-512 ----------------
+// Rows are short (one entry per piece value), so tails are handled with masked loads and
+// stores instead of a scalar epilogue.
+
+__attribute__((target("avx512f"))) __mmask8 tail_mask(int remaining) {
+    return remaining >= 8 ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1U << remaining) - 1U);
+}
+
+// Sum of the lanes of `v`, from its two halves. `_mm512_reduce_add_pd` and the unmasked extracts
+// go through an undefined register in GCC 12, which warns about it.
+__attribute__((target("avx512f"))) double avx512_horizontal_sum(__m512d v) {
+    const __m256d halves = _mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xF, v, 0), _mm512_maskz_extractf64x4_pd(0xF, v, 1));
+    const __m128d quarters = _mm_add_pd(_mm256_castpd256_pd128(halves), _mm256_extractf128_pd(halves, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(quarters, _mm_unpackhi_pd(quarters, quarters)));
+}
+
+__attribute__((target("avx512f"))) double avx512_masked_sum(const double* values, const double* mask, int n) {
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d sum = zero;
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 lanes = tail_mask(n - i);
+        __mmask8 keep = _mm512_mask_cmp_pd_mask(lanes, _mm512_maskz_loadu_pd(lanes, mask + i), zero, _CMP_GT_OQ);
+        sum = _mm512_mask_add_pd(sum, keep, sum, _mm512_maskz_loadu_pd(keep, values + i));
+    }
+    return avx512_horizontal_sum(sum);
+}
+
+__attribute__((target("avx512f"))) double avx512_dot(const double* x, const double* y, int n) {
+    __m512d sum = _mm512_setzero_pd();
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 lanes = tail_mask(n - i);
+        sum = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(lanes, x + i), _mm512_maskz_loadu_pd(lanes, y + i), sum);
+    }
+    return avx512_horizontal_sum(sum);
+}
+
+__attribute__((target("avx512f"))) void avx512_axpby(double a, const double* x, double b, const double* y, double* out, int n) {
+    const __m512d va = _mm512_set1_pd(a);
+    const __m512d vb = _mm512_set1_pd(b);
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 lanes = tail_mask(n - i);
+        __m512d result = _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(lanes, x + i), _mm512_mul_pd(vb, _mm512_maskz_loadu_pd(lanes, y + i)));
+        _mm512_mask_storeu_pd(out + i, lanes, result);
+    }
+}
+
+__attribute__((target("avx512f"))) void avx512_masked_copy(double* out, const double* values, const double* mask, int n) {
+    const __m512d zero = _mm512_setzero_pd();
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 lanes = tail_mask(n - i);
+        __mmask8 keep = _mm512_mask_cmp_pd_mask(lanes, _mm512_maskz_loadu_pd(lanes, mask + i), zero, _CMP_GT_OQ);
+        _mm512_mask_storeu_pd(out + i, keep, _mm512_maskz_loadu_pd(keep, values + i));
+    }
+}
+
+__attribute__((target("avx512f"))) void avx512_masked_multiply(double* out, const double* factors, const double* mask, int n) {
+    const __m512d zero = _mm512_setzero_pd();
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 lanes = tail_mask(n - i);
+        __mmask8 keep = _mm512_mask_cmp_pd_mask(lanes, _mm512_maskz_loadu_pd(lanes, mask + i), zero, _CMP_GT_OQ);
+        __m512d product = _mm512_mul_pd(_mm512_maskz_loadu_pd(keep, out + i), _mm512_maskz_loadu_pd(keep, factors + i));
+        _mm512_mask_storeu_pd(out + i, keep, product);
+    }
+}
+
+__attribute__((target("avx512f"))) void avx512_masked_damped_divide(double* out, const double* numerators, const double* denominators, const double* mask, double damping, int n) {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d new_weight = _mm512_set1_pd(damping);
+    const __m512d old_weight = _mm512_set1_pd(1.0 - damping);
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 lanes = tail_mask(n - i);
+        __mmask8 keep = _mm512_mask_cmp_pd_mask(lanes, _mm512_maskz_loadu_pd(lanes, mask + i), zero, _CMP_GT_OQ);
+        __m512d current = _mm512_maskz_loadu_pd(keep, out + i);
+        __m512d denominator = _mm512_mask_loadu_pd(one, keep, denominators + i);
+        __mmask8 defined = _mm512_mask_cmp_pd_mask(keep, denominator, zero, _CMP_GT_OQ);
+        __m512d ratio = _mm512_maskz_div_pd(defined, _mm512_maskz_loadu_pd(keep, numerators + i), denominator);
+        __m512d updated = _mm512_fmadd_pd(new_weight, ratio, _mm512_mul_pd(old_weight, current));
+        _mm512_mask_storeu_pd(out + i, keep, updated);
+    }
+}
+
+__attribute__((target("avx512f"))) void avx512_normalize(double* out, int n) {
+    __m512d sum = _mm512_setzero_pd();
+    for (int i = 0; i < n; i += 8) {
+        sum = _mm512_add_pd(sum, _mm512_maskz_loadu_pd(tail_mask(n - i), out + i));
+    }
+    const __m512d divisor = _mm512_set1_pd(avx512_horizontal_sum(sum));
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 lanes = tail_mask(n - i);
+        _mm512_mask_storeu_pd(out + i, lanes, _mm512_div_pd(_mm512_maskz_loadu_pd(lanes, out + i), divisor));
+    }
+}
+
+#endif  // BELIEF_SG_X86_KERNELS
+
+const BeliefPropagationKernels kScalarKernels{
+    .level = SimdLevel::Scalar,
+    .masked_sum = scalar_masked_sum,
+    .dot = scalar_dot,
+    .axpby = scalar_axpby,
+    .masked_copy = scalar_masked_copy,
+    .masked_multiply = scalar_masked_multiply,
+    .masked_damped_divide = scalar_masked_damped_divide,
+    .normalize = scalar_normalize
+};
+
+#ifdef BELIEF_SG_X86_KERNELS
+const BeliefPropagationKernels kAVX2Kernels{
+    .level = SimdLevel::AVX2,
+    .masked_sum = avx2_masked_sum,
+    .dot = avx2_dot,
+    .axpby = avx2_axpby,
+    .masked_copy = avx2_masked_copy,
+    .masked_multiply = avx2_masked_multiply,
+    .masked_damped_divide = avx2_masked_damped_divide,
+    .normalize = avx2_normalize
+};
+
+const BeliefPropagationKernels kAVX512Kernels{
+    .level = SimdLevel::AVX512,
+    .masked_sum = avx512_masked_sum,
+    .dot = avx512_dot,
+    .axpby = avx512_axpby,
+    .masked_copy = avx512_masked_copy,
+    .masked_multiply = avx512_masked_multiply,
+    .masked_damped_divide = avx512_masked_damped_divide,
+    .normalize = avx512_normalize
+};
+#endif
+
+SimdLevel cpu_simd_level() {
+#ifdef BELIEF_SG_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+}  // namespace
+
+SimdLevel detected_simd_level() {
+    SimdLevel level = cpu_simd_level();
+    const char* requested = std::getenv("BELIEF_SG_SIMD");
+    const std::string name = requested == nullptr ? "" : requested;
+    if (name == "scalar") {
+        return SimdLevel::Scalar;
+    }
+    if (name == "avx512") {
+        return level;
+    }
+    // Rows hold one entry per piece value (13 to 35 in the bundled games), too short for the
+    // wider registers to pay off: AVX-512 is only used on request.
+    return level == SimdLevel::AVX512 ? SimdLevel::AVX2 : level;
+}
+
+const BeliefPropagationKernels& belief_propagation_kernels([[maybe_unused]] SimdLevel level) {
+#ifdef BELIEF_SG_X86_KERNELS
+    switch (level) {
+        case SimdLevel::AVX512:
+            return kAVX512Kernels;
+        case SimdLevel::AVX2:
+            return kAVX2Kernels;
+        case SimdLevel::Scalar:
+            return kScalarKernels;
+    }
+#endif
+    return kScalarKernels;
+}
+
+const BeliefPropagationKernels& belief_propagation_kernels() {
+    static const BeliefPropagationKernels& kernels = belief_propagation_kernels(detected_simd_level());
+    return kernels;
+}
+
+}  // namespace belief_sg
@@ -2,23 +2,42 @@
 #include "Belief-SG/core/prob_transition.h"
 #include "Belief-SG/core/state.h"
 #include "Belief-SG/core/action.h"
+#include "Belief-SG/core/observation.h"
+
+#include <cstddef>
+#include <optional>
+#include <utility>
 
 namespace belief_sg {
 
 std::vector<ProbTransition> Game::apply_joint_action(const State& state, const std::vector<Action>& joint_action) const {
-    std::vector<ProbTransition> transitions;
-    transitions.push_back(ProbTransition({state, 1.0}));
+    return joint_action_transitions(state, joint_action).to_vector();
+}
 
-    for (const auto& action : joint_action) {
-        std::vector<ProbTransition> new_transitions;
-        for (const auto& transition : transitions) {
-            for (const auto& new_transition : action.apply(transition.state)) {
-                new_transitions.push_back(ProbTransition({new_transition.state, new_transition.probability * transition.probability}));
-            }
+TransitionStream Game::joint_action_transitions(const State& state, const std::vector<Action>& joint_action) const {
+    return joint_action_transitions_from(state, joint_action, 0, 1.0);
+}
+
+std::optional<State> Game::consistent_transition(const State& state, const std::vector<Action>& joint_action, const State& world_state) const {
+    for (ProbTransition& transition : joint_action_transitions(state, joint_action)) {
+        if (transition.state.is_consistent_with(world_state)) {
+            return std::move(transition.state);
+        }
+    }
+    return std::nullopt;
+}
+
+TransitionStream Game::joint_action_transitions_from(State state, const std::vector<Action>& joint_action, std::size_t action_id, double probability) const {
+    if (action_id == joint_action.size()) {
+        ProbTransition transition{std::move(state), probability};
+        co_yield std::move(transition);
+        co_return;
+    }
+    for (ProbTransition& transition : joint_action[action_id].transitions(state)) {
+        for (ProbTransition& new_transition : joint_action_transitions_from(std::move(transition.state), joint_action, action_id + 1, probability * transition.probability)) {
+            co_yield std::move(new_transition);
         }
-        transitions = new_transitions;
     }
-    return transitions;
 }
 
 void Game::apply_joint_action_inplace(State& state, const std::vector<Action>& joint_action, std::mt19937& generator) const {
@@ -27,4 +46,19 @@ void Game::apply_joint_action_inplace(State& state, const std::vector<Action>& j
     }
 }
 
+Observation Game::apply_joint_action_observed(State& world_state, const std::vector<Action>& joint_action, std::mt19937& generator) const {
+    Observation observation;
+    for (const auto& action : joint_action) {
+        action.apply_inplace_observed(world_state, generator, observation);
+    }
+    return observation;
+}
+
+void Game::apply_observation(State& state, const std::vector<Action>& joint_action, const Observation& observation) const {
+    std::size_t draw_id = 0;
+    for (const auto& action : joint_action) {
+        action.apply_observation(state, observation, draw_id);
+    }
+}
+
 }  // namespace belief_sg
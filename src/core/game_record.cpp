@@ -0,0 +1,432 @@
+#include "Belief-SG/core/game_record.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "Belief-SG/core/action.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/observation.h"
+#include "Belief-SG/core/piece_attribute.h"
+#include "Belief-SG/core/piece_value.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/point_of_view.h"
+#include "Belief-SG/core/seeding.h"
+#include "Belief-SG/core/state.h"
+
+namespace belief_sg {
+
+namespace {
+
+constexpr char kMagic[4] = {'B', 'S', 'G', 'R'};
+constexpr unsigned char kVersion = 1;
+constexpr std::size_t kHeaderSize = sizeof(kMagic) + 1;
+constexpr std::size_t kSizePrefix = 4;
+
+constexpr unsigned char kHasObservations = 1;
+
+// Bytes of a record, integers in little endian
+class Encoder {
+public:
+    void varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            bytes_.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        bytes_.push_back(static_cast<char>(value));
+    }
+    void signed_varint(std::int64_t value) {
+        // Zigzag encoding, so that small negative values stay short
+        varint((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+    }
+    void fixed(std::uint64_t value, int n_bytes) {
+        for (int i = 0; i < n_bytes; ++i) {
+            bytes_.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+    void real(double value) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        fixed(bits, 8);
+    }
+    void string(const std::string& value) {
+        varint(value.size());
+        bytes_ += value;
+    }
+    void byte(unsigned char value) {
+        bytes_.push_back(static_cast<char>(value));
+    }
+
+    [[nodiscard]] const std::string& bytes() const {
+        return bytes_;
+    }
+private:
+    std::string bytes_;
+};
+
+class Decoder {
+public:
+    Decoder(const unsigned char* begin, const unsigned char* end) : it_(begin), end_(end) {}
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const unsigned char b = byte();
+            value |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Invalid integer in a game record");
+    }
+    std::int64_t signed_varint() {
+        const std::uint64_t value = varint();
+        return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+    }
+    std::uint64_t fixed(int n_bytes) {
+        std::uint64_t value = 0;
+        for (int i = 0; i < n_bytes; ++i) {
+            value |= static_cast<std::uint64_t>(byte()) << (8 * i);
+        }
+        return value;
+    }
+    double real() {
+        const std::uint64_t bits = fixed(8);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    std::string string() {
+        const std::uint64_t size = varint();
+        require(size);
+        std::string value(reinterpret_cast<const char*>(it_), size);
+        it_ += size;
+        return value;
+    }
+    unsigned char byte() {
+        require(1);
+        return *it_++;
+    }
+    // Number of elements about to be read, each taking at least one byte
+    std::size_t count() {
+        const std::uint64_t n = varint();
+        require(n);
+        return n;
+    }
+private:
+    void require(std::uint64_t n_bytes) const {
+        if (n_bytes > static_cast<std::uint64_t>(end_ - it_)) {
+            throw std::runtime_error("Truncated game record");
+        }
+    }
+
+    const unsigned char* it_;
+    const unsigned char* end_;
+};
+
+void encode_value(Encoder& encoder, const PieceValue& value) {
+    encoder.varint(value.get_attributes().size());
+    for (const PieceAttribute& attribute : value.get_attributes()) {
+        encoder.string(attribute.name());
+        if (const int* number = std::get_if<int>(&attribute.raw_value())) {
+            encoder.byte(0);
+            encoder.signed_varint(*number);
+        } else if (const double* real = std::get_if<double>(&attribute.raw_value())) {
+            encoder.byte(1);
+            encoder.real(*real);
+        } else {
+            encoder.byte(2);
+            encoder.string(std::get<std::string>(attribute.raw_value()));
+        }
+    }
+}
+
+PieceValue decode_value(Decoder& decoder) {
+    std::vector<PieceAttribute> attributes(decoder.count());
+    for (PieceAttribute& attribute : attributes) {
+        std::string name = decoder.string();
+        switch (decoder.byte()) {
+            case 0:
+                attribute = PieceAttribute(std::move(name), static_cast<int>(decoder.signed_varint()));
+                break;
+            case 1:
+                attribute = PieceAttribute(std::move(name), decoder.real());
+                break;
+            case 2:
+                attribute = PieceAttribute(std::move(name), decoder.string());
+                break;
+            default:
+                throw std::runtime_error("Invalid attribute in a game record");
+        }
+    }
+    return PieceValue(attributes);
+}
+
+std::string encode(const GameRecord& record) {
+    // The distinct piece values come first, the draws refer to them by index
+    std::vector<const PieceValue*> values;
+    Encoder steps;
+    steps.varint(record.steps.size());
+    const std::vector<double>* previous_returns = nullptr;
+    for (const GameRecord::Step& step : record.steps) {
+        if (step.action_ids.size() != step.players.size() || step.returns.size() != static_cast<std::size_t>(record.n_players)) {
+            throw std::invalid_argument("A step of the record has the wrong number of actions or returns");
+        }
+        steps.varint(step.players.size());
+        for (std::size_t i = 0; i < step.players.size(); ++i) {
+            steps.signed_varint(step.players[i]);
+            steps.varint(step.action_ids[i]);
+        }
+        // Returns usually stay the same until the end of the game
+        if (previous_returns != nullptr && *previous_returns == step.returns) {
+            steps.byte(0);
+        } else {
+            steps.byte(1);
+            for (double value : step.returns) {
+                steps.real(value);
+            }
+        }
+        previous_returns = &step.returns;
+        if (!record.has_observations) {
+            continue;
+        }
+        steps.varint(step.observation.draws.size());
+        for (const std::vector<PieceValue>& draw : step.observation.draws) {
+            steps.varint(draw.size());
+            for (const PieceValue& value : draw) {
+                auto it = std::ranges::find_if(values, [&](const PieceValue* known) { return *known == value; });
+                if (it == values.end()) {
+                    values.push_back(&value);
+                    it = values.end() - 1;
+                }
+                steps.varint(std::distance(values.begin(), it));
+            }
+        }
+    }
+
+    Encoder encoder;
+    encoder.string(record.game);
+    encoder.fixed(record.seed, 8);
+    encoder.varint(record.n_players);
+    encoder.byte(record.has_observations ? kHasObservations : 0);
+    if (record.has_observations) {
+        encoder.varint(values.size());
+        for (const PieceValue* value : values) {
+            encode_value(encoder, *value);
+        }
+    }
+    return encoder.bytes() + steps.bytes();
+}
+
+GameRecord decode(Decoder& decoder) {
+    GameRecord record;
+    record.game = decoder.string();
+    record.seed = decoder.fixed(8);
+    record.n_players = static_cast<int>(decoder.varint());
+    record.has_observations = (decoder.byte() & kHasObservations) != 0;
+    std::vector<PieceValue> values;
+    if (record.has_observations) {
+        values.resize(decoder.count());
+        for (PieceValue& value : values) {
+            value = decode_value(decoder);
+        }
+    }
+    record.steps.resize(decoder.count());
+    for (std::size_t step_id = 0; step_id < record.steps.size(); ++step_id) {
+        GameRecord::Step& step = record.steps[step_id];
+        const std::size_t n_players = decoder.count();
+        for (std::size_t i = 0; i < n_players; ++i) {
+            step.players.push_back(static_cast<PlayerId>(decoder.signed_varint()));
+            step.action_ids.push_back(static_cast<int>(decoder.varint()));
+        }
+        if (decoder.byte() == 0) {
+            if (step_id == 0) {
+                throw std::runtime_error("The first step of a game record has no returns");
+            }
+            step.returns = record.steps[step_id - 1].returns;
+        } else {
+            step.returns.resize(record.n_players);
+            for (double& value : step.returns) {
+                value = decoder.real();
+            }
+        }
+        if (!record.has_observations) {
+            continue;
+        }
+        step.observation.draws.resize(decoder.count());
+        for (std::vector<PieceValue>& draw : step.observation.draws) {
+            draw.resize(decoder.count());
+            for (PieceValue& value : draw) {
+                value = values.at(decoder.varint());
+            }
+        }
+    }
+    return record;
+}
+
+}  // namespace
+
+std::vector<std::vector<Action>> record_joint_actions(const Game& game, const GameRecord& record) {
+    if (record.game != game.name() || record.n_players != game.num_players()) {
+        throw std::invalid_argument("The record is not a record of this game");
+    }
+    State world_state = game.initial_state(PointOfView(PointOfView::Type::World));
+    // Stream 0 of the seed is the chance generator of the manager
+    std::mt19937 generator = make_generator(stream_seed(record.seed, 0));
+    std::vector<std::vector<Action>> joint_actions;
+    joint_actions.reserve(record.steps.size());
+    for (const GameRecord::Step& step : record.steps) {
+        std::vector<Action> joint_action;
+        joint_action.reserve(step.players.size());
+        for (std::size_t i = 0; i < step.players.size(); ++i) {
+            std::vector<ProbAction> legal_actions = game.legal_actions(world_state, step.players[i]);
+            if (step.action_ids[i] < 0 || static_cast<std::size_t>(step.action_ids[i]) >= legal_actions.size()) {
+                throw std::runtime_error("The record does not match the game");
+            }
+            if (!record.has_observations && step.players[i] == kChancePlayerId) {
+                std::uniform_int_distribution<int> distribution(0, legal_actions.size() - 1);
+                if (distribution(generator) != step.action_ids[i]) {
+                    throw std::runtime_error("The record does not match its seed");
+                }
+            }
+            joint_action.push_back(std::move(legal_actions[step.action_ids[i]].action));
+        }
+        if (record.has_observations) {
+            game.apply_observation(world_state, joint_action, step.observation);
+        } else {
+            (void)game.apply_joint_action_observed(world_state, joint_action, generator);
+        }
+        joint_actions.push_back(std::move(joint_action));
+    }
+    return joint_actions;
+}
+
+GameRecordWriter::GameRecordWriter(const std::string& path) {
+    std::error_code error;
+    const std::uintmax_t file_size = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+    const bool is_new = error || file_size == 0;
+    if (!is_new) {
+        std::ifstream existing(path, std::ios::binary);
+        char header[kHeaderSize];
+        if (!existing.read(header, sizeof(header)) || std::memcmp(header, kMagic, sizeof(kMagic)) != 0 || static_cast<unsigned char>(header[sizeof(kMagic)]) != kVersion) {
+            throw std::runtime_error("Not a game record file: " + path);
+        }
+        // An interrupted writer may have left an incomplete record, which the new ones would
+        // follow and the readers would then skip with it
+        std::uintmax_t end = kHeaderSize;
+        unsigned char prefix[kSizePrefix];
+        while (existing.read(reinterpret_cast<char*>(prefix), sizeof(prefix))) {
+            const std::uintmax_t record_size = Decoder(prefix, prefix + kSizePrefix).fixed(kSizePrefix);
+            if (record_size > file_size - end - kSizePrefix) {
+                break;
+            }
+            end += kSizePrefix + record_size;
+            existing.seekg(static_cast<std::streamoff>(end));
+        }
+        existing.close();
+        if (end != file_size) {
+            std::filesystem::resize_file(path, end);
+        }
+    }
+    file_.open(path, std::ios::binary | std::ios::app);
+    if (!file_) {
+        throw std::runtime_error("Cannot open the game record file " + path);
+    }
+    if (is_new) {
+        file_.write(kMagic, sizeof(kMagic));
+        file_.put(static_cast<char>(kVersion));
+        file_.flush();
+    }
+}
+
+void GameRecordWriter::write(const GameRecord& record) {
+    const std::string bytes = encode(record);
+    if (bytes.size() > UINT32_MAX) {
+        throw std::invalid_argument("The game record is too large");
+    }
+    Encoder prefix;
+    prefix.fixed(bytes.size(), kSizePrefix);
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_.write(prefix.bytes().data(), static_cast<std::streamsize>(prefix.bytes().size()));
+    file_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!file_) {
+        throw std::runtime_error("Cannot write the game record");
+    }
+}
+
+void GameRecordWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_.flush();
+}
+
+GameRecordReader::GameRecordReader(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open the game record file " + path);
+    }
+    struct stat status {};
+    if (::fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot read the game record file " + path);
+    }
+    size_ = static_cast<std::size_t>(status.st_size);
+    if (size_ > 0) {
+        void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map the game record file " + path);
+        }
+        data_ = static_cast<const unsigned char*>(data);
+    }
+    ::close(fd);
+    if (size_ < kHeaderSize || std::memcmp(data_, kMagic, sizeof(kMagic)) != 0 || data_[sizeof(kMagic)] != kVersion) {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<unsigned char*>(data_), size_);
+        }
+        throw std::runtime_error("Not a game record file: " + path);
+    }
+
+    for (std::size_t offset = kHeaderSize; offset + kSizePrefix <= size_;) {
+        const std::size_t record_size = Decoder(data_ + offset, data_ + offset + kSizePrefix).fixed(kSizePrefix);
+        if (record_size > size_ - offset - kSizePrefix) {
+            break;
+        }
+        offsets_.push_back(offset);
+        offset += kSizePrefix + record_size;
+    }
+}
+
+GameRecordReader::~GameRecordReader() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<unsigned char*>(data_), size_);
+        data_ = nullptr;
+    }
+}
+
+std::size_t GameRecordReader::size() const {
+    return offsets_.size();
+}
+
+GameRecord GameRecordReader::record(std::size_t record_id) const {
+    const std::size_t offset = offsets_.at(record_id) + kSizePrefix;
+    const std::size_t record_size = Decoder(data_ + offset - kSizePrefix, data_ + offset).fixed(kSizePrefix);
+    Decoder decoder(data_ + offset, data_ + offset + record_size);
+    return decode(decoder);
+}
+
+}  // namespace belief_sg
@@ -1,21 +1,33 @@
 #include "Belief-SG/core/manager.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <optional>
 #include <random>
+#include <stdexcept>
+#include <string>
 
 #include "Belief-SG/core/action.h"
 #include "Belief-SG/core/game.h"
 #include "Belief-SG/core/agent.h"
+#include "Belief-SG/core/game_record.h"
+#include "Belief-SG/core/observation.h"
 #include "Belief-SG/core/player_id.h"
 #include "Belief-SG/core/point_of_view.h"
-#include "Belief-SG/core/prob_transition.h"
+#include "Belief-SG/core/seeding.h"
 
 namespace belief_sg {
 
-Manager::Manager(std::shared_ptr<Game> game, std::vector<std::unique_ptr<Agent>> agents) : game_(std::move(game)), agents_(std::move(agents)) {
+Manager::Manager(std::shared_ptr<Game> game, std::vector<std::unique_ptr<Agent>> agents)
+    : Manager(std::move(game), std::move(agents), random_seed()) {}
+
+Manager::Manager(std::shared_ptr<Game> game, std::vector<std::unique_ptr<Agent>> agents, std::uint64_t seed)
+    : game_(std::move(game)), agents_(std::move(agents)), seed_(seed), generator_(make_generator(stream_seed(seed, 0))) {
     world_state_ = game_->initial_state(PointOfView(PointOfView::Type::World));
     for (PlayerId player_id = 0; player_id < game_->num_players(); player_id++) {
         private_states_.push_back(game_->initial_state(PointOfView(PointOfView::Type::Private, player_id)));
@@ -25,14 +37,18 @@ Manager::Manager(std::shared_ptr<Game> game, std::vector<std::unique_ptr<Agent>>
     for (PlayerId player_id = 0; player_id < game_->num_players(); player_id++) {
         agents_[player_id]->set_game(game_);
         agents_[player_id]->set_player(player_id);
+        agents_[player_id]->set_seed(stream_seed(seed_, player_id + 1));
     }
-
-    generator_ = std::mt19937(std::random_device{}());
 }
 
 std::vector<double> Manager::play(bool verbose) {
 
-    int step = 0;
+    std::size_t step = 0;
+    history_.clear();
+    GameRecord record;
+    if (record_writer_ != nullptr) {
+        record = {.game = game_->name(), .seed = seed_, .n_players = game_->num_players(), .has_observations = record_observations_, .steps = {}};
+    }
 
     while (!game_->is_terminal(world_state_)) {
         if (verbose) {
@@ -40,8 +56,10 @@ std::vector<double> Manager::play(bool verbose) {
             std::cout << world_state_.to_string() << "\n";
         }
 
+        const std::vector<PlayerId> players = world_state_.current_players();
         std::vector<Action> actions;
-        for (const PlayerId& player_id : world_state_.current_players()) {
+        std::vector<int> action_ids;
+        for (const PlayerId& player_id : players) {
 
             std::vector<ProbAction> legal_actions = game_->legal_actions(world_state_, player_id);
 
@@ -64,7 +82,8 @@ std::vector<double> Manager::play(bool verbose) {
             } else {
                 action = agents_[player_id]->act(private_states_[player_id], public_state_);
             }
-            if (std::ranges::find(legal_actions, action, &ProbAction::action) == legal_actions.end()) {
+            auto it = std::ranges::find(legal_actions, action, &ProbAction::action);
+            if (it == legal_actions.end()) {
                 if (verbose) {
                     std::cout << "Illegal action\n";
                     std::cout << private_states_[player_id].to_string() << "\n";
@@ -73,60 +92,47 @@ std::vector<double> Manager::play(bool verbose) {
             }
 
             actions.push_back(action);
+            action_ids.push_back(static_cast<int>(std::distance(legal_actions.begin(), it)));
         }
 
-        if (actions.size() != world_state_.current_players().size()) {
+        if (actions.size() != players.size()) {
             if (verbose) {
                 std::cout << "Not all players have chosen an action\n";
             }
             break;
         }
 
-        std::vector<ProbTransition> world_transitions = game_->apply_joint_action(world_state_, actions);
-        std::uniform_int_distribution<int> distribution(0, world_transitions.size() - 1);
-        world_state_ = world_transitions[distribution(generator_)].state;
-
-        for (PlayerId player_id = 0; player_id < game_->num_players(); player_id++) {
-
-            std::vector<ProbTransition> private_transitions = game_->apply_joint_action(private_states_[player_id], actions);
-            bool found_consistent = false;
-            for (const ProbTransition& private_transition : private_transitions) {
-
-                if (private_transition.state.is_consistent_with(world_state_)) {
-                    private_states_[player_id] = private_transition.state;
-                    found_consistent = true;
-                    break;
-                }
-            }
-
-            if (!found_consistent) {
-                if (verbose) {
-                    std::cout << "Player " << player_id << " private state is inconsistent\n";
-                }
-                break;
-            }
+        if (replay_.has_value() && (step >= replay_->size() || (*replay_)[step] != actions)) {
+            throw std::runtime_error("The match diverges from its record at step " + std::to_string(step));
         }
+        history_.push_back(actions);
 
-        bool public_found_consistent = false;
-        std::vector<ProbTransition> public_transitions = game_->apply_joint_action(public_state_, actions);
-        for (const ProbTransition& public_transition : public_transitions) {
-
-            if (public_transition.state.is_consistent_with(world_state_)) {
-                public_state_ = public_transition.state;
-                public_found_consistent = true;
-                break;
-            }
+        // The world draws the outcome, and the other points of view replay what it revealed
+        // instead of looking for it among all their transitions
+        Observation observation = game_->apply_joint_action_observed(world_state_, actions, generator_);
+        for (PlayerId player_id = 0; player_id < game_->num_players(); player_id++) {
+            game_->apply_observation(private_states_[player_id], actions, observation);
         }
-
-        if (!public_found_consistent) {
-            if (verbose) {
-                std::cout << "Public state is inconsistent\n";
+        game_->apply_observation(public_state_, actions, observation);
+        if (record_writer_ != nullptr) {
+            GameRecord::Step& record_step = record.steps.emplace_back();
+            record_step.players = players;
+            record_step.action_ids = std::move(action_ids);
+            record_step.returns = game_->returns(world_state_);
+            if (record_observations_) {
+                record_step.observation = std::move(observation);
             }
-            break;
         }
 
         step++;
     }
+    n_steps_ = static_cast<int>(step);
+    if (record_writer_ != nullptr) {
+        record_writer_->write(record);
+    }
+    if (replay_.has_value() && step != replay_->size()) {
+        throw std::runtime_error("The match diverges from its record at step " + std::to_string(step));
+    }
 
     if (verbose) {
         std::cout << "Step " << step << "\n";
@@ -156,4 +162,25 @@ std::vector<double> Manager::play(bool verbose) {
     return game_->returns(world_state_);
 }
 
+std::uint64_t Manager::seed() const {
+    return seed_;
+}
+
+int Manager::num_steps() const {
+    return n_steps_;
+}
+
+const std::vector<std::vector<Action>>& Manager::history() const {
+    return history_;
+}
+
+void Manager::set_replay(std::vector<std::vector<Action>> history) {
+    replay_ = std::move(history);
+}
+
+void Manager::set_record_writer(std::shared_ptr<GameRecordWriter> writer, bool with_observations) {
+    record_writer_ = std::move(writer);
+    record_observations_ = with_observations;
+}
+
 }  // namespace belief_sg
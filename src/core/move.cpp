@@ -1,7 +1,35 @@
 #include "Belief-SG/core/move.h"
 
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include "Belief-SG/core/observation.h"
+#include "Belief-SG/core/prob_transition.h"
+
 namespace belief_sg {
 
+TransitionStream Move::transitions(const State& state) const {
+    for (ProbTransition& transition : apply(state)) {
+        co_yield std::move(transition);
+    }
+}
+
+void Move::apply_inplace_observed(State& state, std::mt19937& generator, Observation& /*observation*/) const {
+    apply_inplace(state, generator);
+}
+
+void Move::apply_observation(State& state, const Observation& /*observation*/, std::size_t& /*draw_id*/) const {
+    TransitionStream stream = transitions(state);
+    auto it = stream.begin();
+    State new_state = std::move((*it).state);
+    if (++it != stream.end()) {
+        throw std::logic_error("A move with several transitions must replay the observation");
+    }
+    state = std::move(new_state);
+}
+
 bool Move::operator==(const Move& other) const {
     return typeid(*this) == typeid(other) && is_equals(other);
 }
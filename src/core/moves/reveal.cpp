@@ -1,11 +1,13 @@
 #include "Belief-SG/core/moves/reveal.h"
 
+#include "Belief-SG/core/observation.h"
 #include "Belief-SG/core/piece_value.h"
 #include "Belief-SG/core/position.h"
 #include "Belief-SG/core/prob_transition.h"
 
 #include <cstddef>
 #include <random>
+#include <utility>
 #include <vector>
 
 namespace belief_sg {
@@ -13,59 +15,71 @@ namespace belief_sg {
 Reveal::Reveal(const Position& from, const std::vector<PlayerId>& observers) : from_(from), observers_(observers) {}
 
 std::vector<ProbTransition> Reveal::apply(const State& state) const {
+    return transitions(state).to_vector();
+}
 
+TransitionStream Reveal::transitions(const State& state) const {
     State copy_state(state);
     bool is_seen = copy_state.add_observers(from_, observers_);
     if (!is_seen) {
-        return std::vector<ProbTransition>{ProbTransition({copy_state, 1.0})};
+        ProbTransition transition{std::move(copy_state), 1.0};
+        co_yield std::move(transition);
+        co_return;
     }
 
-    std::vector<ProbTransition> transitions;
     if (from_.has_stack_id()) {
-        const Piece& piece = copy_state.get_piece_at(from_);
+        const Piece piece = copy_state.get_piece_at(from_);
         for (const PieceValue& value : piece.values) {
             State new_state(copy_state);
             new_state.assign_piece_value(from_, value);
-            transitions.push_back(ProbTransition({new_state, piece.probability(value)}));
+            ProbTransition transition{std::move(new_state), piece.probability(value)};
+            co_yield std::move(transition);
         }
     } else {
-        transitions.push_back(ProbTransition({copy_state, 1.0}));
-
         int n_pieces = static_cast<int>(copy_state.get_pieces_at(from_).size());
-        for (int i = 0; i < n_pieces; i++) {
+        for (ProbTransition& transition : assign_values(std::move(copy_state), 0, n_pieces, 1.0)) {
+            co_yield std::move(transition);
+        }
+    }
+}
 
-            std::vector<ProbTransition> new_transitions;
-            for (const ProbTransition& transition : transitions) {
-                const Piece& piece = transition.state.get_piece_at(Position(from_.cell_id(), i));
-                for (const PieceValue& value : piece.values) {
-                    State new_state(transition.state);
-                    new_state.assign_piece_value(Position(from_.cell_id(), i), value);
-                    new_transitions.push_back(ProbTransition({new_state, transition.probability * piece.probability(value)}));
-                }
-            }
-            transitions = new_transitions;
+TransitionStream Reveal::assign_values(State state, int stack_id, int n_pieces, double probability) const {
+    if (stack_id == n_pieces) {
+        ProbTransition transition{std::move(state), probability};
+        co_yield std::move(transition);
+        co_return;
+    }
+    // Depth first, so that the combinations of values are only built as they are asked for
+    const Position position(from_.cell_id(), stack_id);
+    const Piece piece = state.get_piece_at(position);
+    for (const PieceValue& value : piece.values) {
+        State new_state(state);
+        new_state.assign_piece_value(position, value);
+        for (ProbTransition& transition : assign_values(std::move(new_state), stack_id + 1, n_pieces, probability * piece.probability(value))) {
+            co_yield std::move(transition);
         }
     }
-    return transitions;
 }
 
 void Reveal::apply_inplace(State& state, std::mt19937& generator) const {
-    bool is_seen = state.add_observers(from_, observers_);
-    if (!is_seen) {
-      return;
+    if (state.add_observers(from_, observers_)) {
+        state.draw_piece_values(from_, generator);
     }
+}
 
-    if (from_.has_stack_id()) {
-        const Piece& piece = state.get_piece_at(from_);
-        std::uniform_int_distribution<std::size_t> dist(0, piece.values.size()-1);
-        state.assign_piece_value(from_, piece.values[dist(generator)]);
-    } else {
-        int n_pieces = static_cast<int>(state.get_pieces_at(from_).size());
-        for (int i = 0; i < n_pieces; i++) {
-            const Piece& piece = state.get_piece_at(Position(from_.cell_id(), i));
-            std::uniform_int_distribution<std::size_t> dist(0, piece.values.size()-1);
-            state.assign_piece_value(Position(from_.cell_id(), i), piece.values[dist(generator)]);
-        }
+void Reveal::apply_inplace_observed(State& state, std::mt19937& generator, Observation& observation) const {
+    std::vector<PieceValue> values;
+    if (state.add_observers(from_, observers_)) {
+        values = state.draw_piece_values(from_, generator);
+    }
+    observation.draws.push_back(std::move(values));
+}
+
+void Reveal::apply_observation(State& state, const Observation& observation, std::size_t& draw_id) const {
+    // The world sees every piece that this point of view sees
+    const std::vector<PieceValue>& values = observation.draws.at(draw_id++);
+    if (state.add_observers(from_, observers_)) {
+        state.assign_piece_values(from_, values);
     }
 }
 
@@ -1,11 +1,13 @@
 #include "Belief-SG/core/moves/set_observers.h"
 
+#include "Belief-SG/core/observation.h"
 #include "Belief-SG/core/piece_value.h"
 #include "Belief-SG/core/position.h"
 #include "Belief-SG/core/prob_transition.h"
 
 #include <cstddef>
 #include <random>
+#include <utility>
 #include <vector>
 
 namespace belief_sg {
@@ -52,22 +54,26 @@ std::vector<ProbTransition> SetObservers::apply(const State& state) const {
 
 void SetObservers::apply_inplace(State& state, std::mt19937& generator) const {
     state.hide(from_);
-    bool is_seen = state.add_observers(from_, observers_);
-    if (!is_seen) {
-      return;
+    if (state.add_observers(from_, observers_)) {
+        state.draw_piece_values(from_, generator);
     }
+}
 
-    if (from_.has_stack_id()) {
-        const Piece& piece = state.get_piece_at(from_);
-        std::uniform_int_distribution<std::size_t> dist(0, piece.values.size()-1);
-        state.assign_piece_value(from_, piece.values[dist(generator)]);
-    } else {
-        int n_pieces = static_cast<int>(state.get_pieces_at(from_).size());
-        for (int i = 0; i < n_pieces; i++) {
-            const Piece& piece = state.get_piece_at(Position(from_.cell_id(), i));
-            std::uniform_int_distribution<std::size_t> dist(0, piece.values.size()-1);
-            state.assign_piece_value(Position(from_.cell_id(), i), piece.values[dist(generator)]);
-        }
+void SetObservers::apply_inplace_observed(State& state, std::mt19937& generator, Observation& observation) const {
+    state.hide(from_);
+    std::vector<PieceValue> values;
+    if (state.add_observers(from_, observers_)) {
+        values = state.draw_piece_values(from_, generator);
+    }
+    observation.draws.push_back(std::move(values));
+}
+
+void SetObservers::apply_observation(State& state, const Observation& observation, std::size_t& draw_id) const {
+    // The world sees every piece that this point of view sees
+    const std::vector<PieceValue>& values = observation.draws.at(draw_id++);
+    state.hide(from_);
+    if (state.add_observers(from_, observers_)) {
+        state.assign_piece_values(from_, values);
     }
 }
 
@@ -12,6 +12,10 @@ const std::string& PieceAttribute::name() const {
     return name_;
 }
 
+const AttributeValue& PieceAttribute::raw_value() const {
+    return value_;
+}
+
 std::string PieceAttribute::to_string() const {
     return "{" + name_ + ", " + std::visit([](const auto& val) -> std::string {
         using T = std::decay_t<decltype(val)>;
@@ -0,0 +1,36 @@
+#include "Belief-SG/core/prob_transition.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace belief_sg {
+
+void merge_duplicate_transitions(std::vector<ProbTransition>& transitions) {
+    // Transitions kept so far, by the hash of their state
+    std::unordered_multimap<std::uint64_t, std::size_t> kept;
+    kept.reserve(transitions.size());
+    std::size_t n_kept = 0;
+    for (std::size_t i = 0; i < transitions.size(); ++i) {
+        const std::uint64_t hash = transitions[i].state.hash();
+        auto [begin, end] = kept.equal_range(hash);
+        auto it = begin;
+        while (it != end && !(transitions[it->second].state == transitions[i].state)) {
+            ++it;
+        }
+        if (it != end) {
+            transitions[it->second].probability += transitions[i].probability;
+            continue;
+        }
+        if (n_kept != i) {
+            transitions[n_kept] = std::move(transitions[i]);
+        }
+        kept.emplace(hash, n_kept);
+        n_kept++;
+    }
+    transitions.resize(n_kept);
+}
+
+}  // namespace belief_sg
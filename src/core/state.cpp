@@ -1,6 +1,7 @@
 #include "Belief-SG/core/state.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <random>
 #include <stdexcept>
 #include <utility>
@@ -10,10 +11,19 @@
 #include <iostream>
 #include <algorithm>
 #include <iterator>
+#include <type_traits>
+#include <variant>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
 
+#ifdef BELIEF_SG_USE_GECODE
 #include <gecode/int.hh>
 #include <gecode/search.hh>
+#endif
 
+#include "Belief-SG/core/belief_propagation_kernels.h"
+#include "Belief-SG/core/hash.h"
 #include "Belief-SG/core/piece_value.h"
 #include "Belief-SG/core/position.h"
 #include "Belief-SG/core/variable.h"
@@ -44,10 +54,15 @@ double Piece::probability(const PieceValue& value) const  {
     if (it == values.end()) {
         return 0.0;
     }
+    if (probs.empty()) {
+        throw std::logic_error("Piece was retrieved without probabilities");
+    }
     auto pos = std::distance(values.begin(), it);
     return probs[pos];
 }
 
+#ifdef BELIEF_SG_USE_GECODE
+
 CollectionModel::CollectionModel(int n_pieces, int n_values) : pieces_(*this, n_pieces, 0, n_values-1), n_pieces_(n_pieces), n_values_(n_values) {
     branch(*this, pieces_, Gecode::INT_VAR_SIZE_MIN(), Gecode::INT_VAL_MIN());
 }
@@ -60,6 +75,31 @@ CollectionModel::Space* CollectionModel::copy() {
     return new CollectionModel(*this);
 }
 
+std::unique_ptr<CollectionModel> CollectionModel::clone_model() const {
+    return std::unique_ptr<CollectionModel>(dynamic_cast<CollectionModel*>(clone()));
+}
+
+bool CollectionModel::propagate() {
+    return status() != Gecode::SS_FAILED;
+}
+
+bool CollectionModel::is_solved() {
+    return status() == Gecode::SS_SOLVED;
+}
+
+bool CollectionModel::has_solution() {
+    if (!propagate()) {
+        return false;
+    }
+    Gecode::DFS<CollectionModel> dfs(this);
+    std::unique_ptr<CollectionModel> solution(dfs.next());
+    return solution != nullptr;
+}
+
+bool CollectionModel::is_assigned(int id) const {
+    return pieces_[id].assigned();
+}
+
 int CollectionModel::get_value(int id) const {
     return pieces_[id].val();
 }
@@ -90,6 +130,14 @@ std::vector<std::vector<bool>> CollectionModel::get_domains() const {
     return domains;
 }
 
+std::uint64_t CollectionModel::domain_hash(int id) const {
+    std::uint64_t hash = 0;
+    for (Gecode::IntVarValues i(pieces_[id]); i(); ++i) {
+        hash = hash_combine(hash, i.val());
+    }
+    return hash;
+}
+
 void CollectionModel::remove_value(int id, int value) {
     Gecode::rel(*this, pieces_[id], Gecode::IRT_NQ, value);
 }
@@ -118,168 +166,302 @@ void CollectionModel::print() const {
     std::cout << pieces_ << std::endl;
 }
 
+#endif  // BELIEF_SG_USE_GECODE
+
+namespace {
+
+// Rounds a section size up to a whole number of cache lines.
+std::size_t padded(std::size_t n_doubles) {
+    constexpr std::size_t doubles_per_line = 64 / sizeof(double);
+    return (n_doubles + doubles_per_line - 1) / doubles_per_line * doubles_per_line;
+}
+
+// Seeds keeping the keys of the different kinds of state components apart
+enum class HashSeed : std::uint64_t {
+    PointOfView = 1,
+    CurrentPlayers,
+    Cell,
+    Piece,
+    Variable,
+    OffBoard
+};
+
+std::uint64_t seeded_hash(HashSeed seed, std::uint64_t value) {
+    return hash_combine(static_cast<std::uint64_t>(seed), value);
+}
+
+}  // namespace
+
 BeliefPropagation::BeliefPropagation(int n_pieces, int n_values, const std::vector<int>& counts)
         : n_variables_(n_pieces),
           n_values_(n_values),
           n_constraints_(n_values_),
-          counts_(counts),
-          variable_messages_(n_variables_, std::vector<std::vector<double>>(n_values_, std::vector<double>(n_constraints_, 0.0))),
-          variable_marginals_(n_variables_, std::vector<double>(n_values_, 0.0)),
-          constraint_messages_(n_constraints_, std::vector<std::vector<double>>(n_variables_, std::vector<double>(n_values_, 0.0))),
-          domains_(n_pieces, std::vector<bool>(n_values, false)) ,
-          probabilities_(n_pieces, std::vector<double>(n_values, 1.0 / static_cast<double>(n_values_))) {
-
-    values_.reserve(counts_.size());
-    for (int value = 0; value < counts_.size(); value++) {
-        values_.push_back(value);
-    }
+          max_count_(*std::max_element(counts.begin(), counts.end())),
+          counts_(counts) {
+
+    const auto messages_size = static_cast<std::size_t>(n_constraints_ * n_variables_ * n_values_);
+    const auto marginals_size = static_cast<std::size_t>(n_variables_ * n_values_);
+    const auto dp_size = static_cast<std::size_t>(n_variables_ * (max_count_ + 1));
+
+    std::size_t offset = 0;
+    variable_messages_ = offset;
+    offset += padded(messages_size);
+    constraint_messages_ = offset;
+    offset += padded(messages_size);
+    variable_marginals_ = offset;
+    offset += padded(marginals_size);
+    probabilities_ = offset;
+    offset += padded(marginals_size);
+    domains_ = offset;
+    offset += padded(marginals_size);
+    prefix_ = offset;
+    offset += padded(dp_size);
+    suffix_ = offset;
+    offset += padded(dp_size);
+    hit_weights_ = offset;
+    offset += padded(static_cast<std::size_t>(n_variables_));
+    miss_weights_ = offset;
+    offset += padded(static_cast<std::size_t>(n_variables_));
+    previous_marginals_ = offset;
+    offset += padded(static_cast<std::size_t>(n_values_));
+    previous_messages_ = offset;
+    offset += padded(static_cast<std::size_t>(n_values_));
+    variable_residuals_ = offset;
+    offset += padded(static_cast<std::size_t>(n_variables_));
+
+    arena_.assign(offset, 0.0);
+    std::fill_n(arena_.begin() + static_cast<std::ptrdiff_t>(probabilities_), marginals_size, 1.0 / static_cast<double>(n_values_));
 }
 
 void BeliefPropagation::update_probabilities(const std::vector<std::vector<bool>>& domains) {
-    if (domains == domains_) {
+    // Variables whose domain only lost values are flagged with an infinite residual, so that a
+    // converged factor graph can be warm started from them instead of being reset.
+    double* residuals = arena_.data() + variable_residuals_;
+    bool same_domains = true;
+    bool only_removals = true;
+    for (int variable_id = 0; variable_id < n_variables_; variable_id++) {
+        double* variable_domain = domain(variable_id);
+        for (int value_id = 0; value_id < n_values_; value_id++) {
+            double flag = domains[variable_id][value_id] ? 1.0 : 0.0;
+            if (variable_domain[value_id] != flag) {
+                only_removals = only_removals && flag == 0.0;
+                variable_domain[value_id] = flag;
+                residuals[variable_id] = std::numeric_limits<double>::infinity();
+                same_domains = false;
+            }
+        }
+    }
+    if (same_domains) {
         return;
     }
-    domains_ = domains;
 
-    reset_variables_messages_and_marginals();
-    reset_constraints_messages();
+    if (!(converged_ && only_removals && warm_start() && propagate(true))) {
+        reset_variables_messages_and_marginals();
+        reset_constraints_messages();
+        converged_ = propagate(false);
+    }
+
+    std::copy_n(arena_.begin() + static_cast<std::ptrdiff_t>(variable_marginals_), n_variables_ * n_values_, arena_.begin() + static_cast<std::ptrdiff_t>(probabilities_));
+}
+
+bool BeliefPropagation::warm_start() {
+    const double* residuals = arena_.data() + variable_residuals_;
+    for (int variable_id = 0; variable_id < n_variables_; variable_id++) {
+        if (residuals[variable_id] != std::numeric_limits<double>::infinity()) {
+            continue;
+        }
+        const double* variable_domain = domain(variable_id);
+        double* marginals = variable_marginals(variable_id);
+        double mass = 0.0;
+        for (int value_id = 0; value_id < n_values_; value_id++) {
+            if (variable_domain[value_id] > 0.0) {
+                mass += marginals[value_id];
+                continue;
+            }
+            marginals[value_id] = 0.0;
+            for (int constraint_id = 0; constraint_id < n_constraints_; constraint_id++) {
+                variable_messages(constraint_id, variable_id)[value_id] = 0.0;
+                constraint_messages(constraint_id, variable_id)[value_id] = 0.0;
+            }
+        }
+        // Removing likely values moves the fixed point too far for a warm start to beat a reset,
+        // which converges in a couple of sweeps from uniform messages
+        if (!(mass > 1.0 - warm_start_max_removed_mass_)) {
+            return false;
+        }
+        kernels_->normalize(marginals, n_values_);
+        for (int constraint_id = 0; constraint_id < n_constraints_; constraint_id++) {
+            kernels_->normalize(variable_messages(constraint_id, variable_id), n_values_);
+            kernels_->normalize(constraint_messages(constraint_id, variable_id), n_values_);
+        }
+    }
+    return true;
+}
 
+bool BeliefPropagation::propagate(bool incremental) {
     damping_ = 0.5;
 
-    for (int iter = 0; iter < n_iter_; iter++) {
-        compute_constraints_messages();
-        double change = compute_variables_messages_and_marginals();
+    const int n_iter = incremental ? n_incremental_iter_ : n_iter_;
+    for (int iter = 0; iter < n_iter; iter++) {
+        compute_constraints_messages(incremental);
+        double change = compute_variables_messages_and_marginals(incremental);
+        // Once a message is not finite it spreads to the whole factor graph: stop early
+        if (!marginals_are_finite()) {
+            return false;
+        }
         if (change < epsilon_) {
-            break;
+            return true;
         }
         damping_ += 0.025;
         damping_ = std::min(damping_, 1.0);
     }
+    return false;
+}
 
-    for (int piece_id = 0; piece_id < n_variables_; piece_id++) {
-        for (int value_id = 0; value_id < n_values_; value_id++) {
-            probabilities_[piece_id][value_id] = variable_marginals_[piece_id][value_id];
-        }
-    }
+bool BeliefPropagation::marginals_are_finite() const {
+    const auto first = arena_.begin() + static_cast<std::ptrdiff_t>(variable_marginals_);
+    return std::all_of(first, first + n_variables_ * n_values_, [](double marginal) {
+        return std::isfinite(marginal);
+    });
 }
 
 void BeliefPropagation::reset_variables_messages_and_marginals() {
     for (int variable_id = 0; variable_id < n_variables_; variable_id++) {
+        const double* variable_domain = domain(variable_id);
         double domain_size = 0;
-        for (bool value_b : domains_[variable_id]) {
-            if (value_b) {
-                domain_size++;
-            }
+        for (int value_id = 0; value_id < n_values_; value_id++) {
+            domain_size += variable_domain[value_id];
         }
         double prob = 1.0/domain_size;
+        double* marginals = variable_marginals(variable_id);
         for (int value_id = 0; value_id < n_values_; value_id++) {
-            double updated_value = domains_[variable_id][value_id] ? prob : 0.0;
-            std::fill(variable_messages_[variable_id][value_id].begin(), variable_messages_[variable_id][value_id].end(), updated_value);
-            variable_marginals_[variable_id][value_id] = updated_value;
+            marginals[value_id] = variable_domain[value_id] > 0.0 ? prob : 0.0;
+        }
+        for (int constraint_id = 0; constraint_id < n_constraints_; constraint_id++) {
+            std::copy_n(marginals, n_values_, variable_messages(constraint_id, variable_id));
         }
     }
 }
 
 void BeliefPropagation::reset_constraints_messages() {
-    for (int constraint_id = 0; constraint_id < n_constraints_; constraint_id++) {
-        for (int variable_id = 0; variable_id < n_variables_; variable_id++) {
-            std::fill(constraint_messages_[constraint_id][variable_id].begin(), constraint_messages_[constraint_id][variable_id].end(), 0.0);
-        }
-    }
+    std::fill_n(arena_.begin() + static_cast<std::ptrdiff_t>(constraint_messages_), n_constraints_ * n_variables_ * n_values_, 0.0);
+    std::fill_n(arena_.begin() + static_cast<std::ptrdiff_t>(variable_residuals_), n_variables_, 0.0);
 }
 
-void BeliefPropagation::compute_constraints_messages() {
+void BeliefPropagation::compute_constraints_messages(bool track_residuals) {
     for (int constraint_id = 0; constraint_id < n_constraints_; constraint_id++) {
-        compute_constraint_messages(constraint_id);
+        compute_constraint_messages(constraint_id, track_residuals);
     }
 }
 
-void BeliefPropagation::compute_constraint_messages(int constraint_id) {
-    // Forward pass
-    std::vector<std::vector<double>> prefix(n_variables_, std::vector<double>(counts_[constraint_id]+1, 0.0));
-    prefix[0][0] = 1.0;
+void BeliefPropagation::compute_constraint_messages(int constraint_id, bool track_residuals) {
+    const BeliefPropagationKernels& kernels = *kernels_;
+    const int count = counts_[constraint_id];
+    double* hits = arena_.data() + hit_weights_;
+    double* misses = arena_.data() + miss_weights_;
+    double* previous_messages = arena_.data() + previous_messages_;
+    double* residuals = arena_.data() + variable_residuals_;
+
+    // A count constraint only distinguishes its own value from the others, so each variable
+    // contributes two weights to the dynamic program: taking the constraint value or not.
+    for (int variable_id = 0; variable_id < n_variables_; variable_id++) {
+        const double* marginals = variable_marginals(variable_id);
+        const double* messages = variable_messages(constraint_id, variable_id);
+        double total = kernels.masked_sum(messages, marginals, n_values_);
+        hits[variable_id] = marginals[constraint_id] > 0.0 ? messages[constraint_id] : 0.0;
+        misses[variable_id] = total - hits[variable_id];
+    }
+
+    // Forward pass: prefix(v)[j] weights the assignments of the variables before v with j hits
+    double* first = prefix(0);
+    std::fill_n(first, count+1, 0.0);
+    first[0] = 1.0;
     for (int variable_id = 0; variable_id < n_variables_-1; variable_id++) {
-        for (int value_id = 0; value_id < n_values_; value_id++) {
-            if (variable_marginals_[variable_id][value_id] <= 0.0) {
-                continue;
-            }
-            int added_value = static_cast<int>(value_id == values_[constraint_id]);
-            for (int j = 0; j < counts_[constraint_id]+1; j++) {
-                if (prefix[variable_id][j] > 0.0 && j + added_value <= counts_[constraint_id]) {
-                    prefix[variable_id+1][j+added_value] += prefix[variable_id][j] * variable_messages_[variable_id][value_id][constraint_id];
-                }
-            }
-        }
+        const double* current = prefix(variable_id);
+        double* next = prefix(variable_id+1);
+        next[0] = misses[variable_id] * current[0];
+        kernels.axpby(misses[variable_id], current+1, hits[variable_id], current, next+1, count);
     }
 
     // Backward pass and message computation
-    std::vector<std::vector<double>> suffix(n_variables_, std::vector<double>(counts_[constraint_id]+1, 0.0));
-    suffix[n_variables_-1][counts_[constraint_id]] = 1.0;
-    for (int variable_id = n_variables_-1; variable_id > 0; variable_id--) {
+    double* last = suffix(n_variables_-1);
+    std::fill_n(last, count+1, 0.0);
+    last[count] = 1.0;
+    for (int variable_id = n_variables_-1; variable_id >= 0; variable_id--) {
+        const double* current = suffix(variable_id);
+        double miss_belief = 0.0;
+        double hit_belief = 0.0;
+        if (variable_id > 0) {
+            double* previous = suffix(variable_id-1);
+            kernels.axpby(misses[variable_id], current, hits[variable_id], current+1, previous, count);
+            previous[count] = misses[variable_id] * current[count];
+
+            const double* forward = prefix(variable_id);
+            miss_belief = kernels.dot(forward, current, count+1);
+            hit_belief = kernels.dot(forward, current+1, count);
+        } else {
+            miss_belief = current[0];
+            hit_belief = count > 0 ? current[1] : 0.0;
+        }
+
+        const double* marginals = variable_marginals(variable_id);
+        double* outgoing = constraint_messages(constraint_id, variable_id);
+        if (track_residuals) {
+            std::copy_n(outgoing, n_values_, previous_messages);
+        }
         for (int value_id = 0; value_id < n_values_; value_id++) {
-            if (variable_marginals_[variable_id][value_id] <= 0.0) {
+            if (marginals[value_id] <= 0.0) {
                 continue;
             }
-            int added_value = static_cast<int>(value_id == values_[constraint_id]);
-            double belief = 0.0;
-            for (int j = 0; j < counts_[constraint_id]+1; j++) {
-                if (j+added_value <= counts_[constraint_id] && suffix[variable_id][j + added_value] > 0.0) {
-                    suffix[variable_id-1][j] += suffix[variable_id][j+added_value] * variable_messages_[variable_id][value_id][constraint_id];
-                    belief += prefix[variable_id][j] * suffix[variable_id][j+added_value];
-                }
-            }
-            double old_message = constraint_messages_[constraint_id][variable_id][value_id];
-            constraint_messages_[constraint_id][variable_id][value_id] = damping_ * belief + (1.0 - damping_) * old_message;
-        }
-    }
-    for (int value_id = 0; value_id < n_values_; value_id++) {
-        if (variable_marginals_[0][value_id] <= 0.0) {
-            continue;
+            double belief = value_id == constraint_id ? hit_belief : miss_belief;
+            outgoing[value_id] = damping_ * belief + (1.0 - damping_) * outgoing[value_id];
         }
-        int added_value = static_cast<int>(value_id == values_[constraint_id]);
-        double old_message = constraint_messages_[constraint_id][0][value_id];
-        constraint_messages_[constraint_id][0][value_id] = damping_ * suffix[0][added_value] + (1.0 - damping_) * old_message;
-    }
-
-    normalize_constraint_messages(constraint_id);
-}
+        kernels.normalize(outgoing, n_values_);
 
-void BeliefPropagation::normalize_constraint_messages(int constraint_id) {
-    for (int variable_id = 0; variable_id < n_variables_; variable_id++) {
-        double sum = 0.0;
-        for (int value_id = 0; value_id < n_values_; value_id++) {
-            sum += constraint_messages_[constraint_id][variable_id][value_id];
-        }
-        for (int value_id = 0; value_id < n_values_; value_id++) {
-            constraint_messages_[constraint_id][variable_id][value_id] /= sum;
+        if (track_residuals) {
+            double change = 0.0;
+            for (int value_id = 0; value_id < n_values_; value_id++) {
+                change = std::max(std::abs(outgoing[value_id] - previous_messages[value_id]), change);
+            }
+            residuals[variable_id] += change;
         }
     }
 }
 
-double BeliefPropagation::compute_variables_messages_and_marginals() {
+double BeliefPropagation::compute_variables_messages_and_marginals(bool incremental) {
+    double* residuals = arena_.data() + variable_residuals_;
     double max_change = 0.0;
     for (int variable_id = 0; variable_id < n_variables_; variable_id++) {
+        // Residuals accumulate, so a variable skipped several times is eventually refreshed
+        if (incremental && residuals[variable_id] < epsilon_) {
+            continue;
+        }
+        residuals[variable_id] = 0.0;
         max_change = std::max(compute_variable_messages_and_marginals(variable_id), max_change);
     }
     return max_change;
 }
 
 double BeliefPropagation::compute_variable_messages_and_marginals(int variable_id) {
-    std::vector<double> prev_marginals(variable_marginals_[variable_id]);
+    const BeliefPropagationKernels& kernels = *kernels_;
+    double* marginals = variable_marginals(variable_id);
+    double* prev_marginals = arena_.data() + previous_marginals_;
+    std::copy_n(marginals, n_values_, prev_marginals);
 
-    for (int value_id = 0; value_id < n_values_; value_id++) {
-        if (variable_marginals_[variable_id][value_id] <= 0.0) {
-            continue;
-        }
-        double marginal = 1.0;
-        for (int constraint_id = 0; constraint_id < n_constraints_; constraint_id++) {
-            marginal *= constraint_messages_[constraint_id][variable_id][value_id];
-        }
-        for (int constraint_id = 0; constraint_id < n_constraints_; constraint_id++) {
-            double old_message = variable_messages_[variable_id][value_id][constraint_id];
-            variable_messages_[variable_id][value_id][constraint_id] = damping_ * marginal / constraint_messages_[constraint_id][variable_id][value_id] + (1.0 - damping_) * old_message;
-        }
-        variable_marginals_[variable_id][value_id] = marginal;
+    // Product of the incoming messages, accumulated constraint by constraint over contiguous rows
+    kernels.masked_copy(marginals, constraint_messages(0, variable_id), prev_marginals, n_values_);
+    for (int constraint_id = 1; constraint_id < n_constraints_; constraint_id++) {
+        kernels.masked_multiply(marginals, constraint_messages(constraint_id, variable_id), prev_marginals, n_values_);
+    }
+    for (int constraint_id = 0; constraint_id < n_constraints_; constraint_id++) {
+        kernels.masked_damped_divide(
+            variable_messages(constraint_id, variable_id),
+            marginals,
+            constraint_messages(constraint_id, variable_id),
+            prev_marginals,
+            damping_,
+            n_values_
+        );
     }
 
     normalize_variable_messages(variable_id);
@@ -287,46 +469,40 @@ double BeliefPropagation::compute_variable_messages_and_marginals(int variable_i
 
     double max_change = 0.0;
     for (int value_id = 0; value_id < n_values_; value_id++) {
-        max_change = std::max(std::abs(prev_marginals[value_id] - variable_marginals_[variable_id][value_id]), max_change);
+        max_change = std::max(std::abs(prev_marginals[value_id] - marginals[value_id]), max_change);
     }
     return max_change;
 }
 
 void BeliefPropagation::normalize_variable_messages(int variable_id) {
     for (int constraint_id = 0; constraint_id < n_constraints_; constraint_id++) {
-        double sum = 0.0;
-        for (int value_id = 0; value_id < n_values_; value_id++) {
-            sum += variable_messages_[variable_id][value_id][constraint_id];
-        }
-        for (int value_id = 0; value_id < n_values_; value_id++) {
-            variable_messages_[variable_id][value_id][constraint_id] /= sum;
-        }
+        kernels_->normalize(variable_messages(constraint_id, variable_id), n_values_);
     }
 }
 
 void BeliefPropagation::normalize_variable_marginals(int variable_id) {
-    double sum = 0.0;
-    for (int value_id = 0; value_id < n_values_; value_id++) {
-        sum += variable_marginals_[variable_id][value_id];
-    }
-    for (int value_id = 0; value_id < n_values_; value_id++) {
-        variable_marginals_[variable_id][value_id] /= sum;
-    }
+    kernels_->normalize(variable_marginals(variable_id), n_values_);
 }
 
-CollectionWrapper::CollectionWrapper(std::shared_ptr<const PieceType> ptype, int n_pieces, const std::vector<int>& counts) : type(std::move(ptype)), rbp(n_pieces, type->size(), counts) {
-    original_model = std::make_unique<CollectionModel>(n_pieces, type->size());
-    original_model->add_counts(counts);
+CollectionWrapper::CollectionWrapper(std::shared_ptr<const PieceType> ptype, int n_pieces, const std::vector<int>& counts) : type(std::move(ptype)), rbp(std::in_place, n_pieces, type->size(), counts) {
+    auto initial_model = std::make_shared<CollectionModel>(n_pieces, type->size());
+    initial_model->add_counts(counts);
+    initial_model->propagate();
+    original_model = std::move(initial_model);
     model = std::make_unique<CollectionModel>(n_pieces, type->size());
     model->add_counts(counts);
     observers = std::vector<std::vector<PlayerId>>(n_pieces, std::vector<PlayerId>());
 }
 
 CollectionWrapper::CollectionWrapper(const CollectionWrapper& other)
+    : CollectionWrapper(other, std::lock_guard<std::mutex>(other.rbp_mutex)) {}
+
+CollectionWrapper::CollectionWrapper(const CollectionWrapper& other, const std::lock_guard<std::mutex>& /*lock*/)
     : type(other.type),
-      original_model(dynamic_cast<CollectionModel*>(other.original_model->clone())),
-      model(dynamic_cast<CollectionModel*>(other.model->clone())),
+      original_model(other.original_model),
+      model(other.model->clone_model()),
       rbp(other.rbp),
+      probabilities_outdated(other.probabilities_outdated.load()),
       observers(other.observers) {}
 
 CollectionWrapper& CollectionWrapper::operator=(const CollectionWrapper& other) {
@@ -336,13 +512,36 @@ CollectionWrapper& CollectionWrapper::operator=(const CollectionWrapper& other)
 }
 
 void CollectionWrapper::swap(CollectionWrapper& other) noexcept {
+    if (this == &other) {
+        return;
+    }
+    std::scoped_lock lock(rbp_mutex, other.rbp_mutex);
     std::swap(type, other.type);
     std::swap(original_model, other.original_model);
     std::swap(model, other.model);
     std::swap(rbp, other.rbp);
+    probabilities_outdated = other.probabilities_outdated.exchange(probabilities_outdated);
     std::swap(observers, other.observers);
 }
 
+void CollectionWrapper::invalidate_probabilities() {
+    probabilities_outdated = true;
+}
+
+double CollectionWrapper::probability(int piece_id, int value) const {
+    if (model->is_assigned(piece_id)) {
+        return 1.0;
+    }
+    if (probabilities_outdated.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(rbp_mutex);
+        if (probabilities_outdated.load(std::memory_order_relaxed)) {
+            rbp.write().update_probabilities(model->get_domains());
+            probabilities_outdated.store(false, std::memory_order_release);
+        }
+    }
+    return rbp->get_probability(piece_id, value);
+}
+
 std::shared_ptr<const Game> State::game() const {
     return game_;
 }
@@ -351,59 +550,89 @@ PointOfView State::point_of_view() const {
     return point_of_view_;
 }
 
+State State::private_view(PlayerId player_id) const {
+    if (point_of_view_.type != PointOfView::Type::Public) {
+        throw std::invalid_argument("Only a public state can be viewed privately");
+    }
+    State view(*this);
+    view.hash_ ^= point_of_view_hash();
+    view.point_of_view_ = PointOfView(PointOfView::Type::Private, player_id);
+    view.hash_ ^= view.point_of_view_hash();
+    return view;
+}
+
 const std::vector<PlayerId>& State::current_players() const {
     return current_players_;
 }
 
 void State::set_current_player(PlayerId player_id) {
+    if (trail_.recording) {
+        record(CurrentPlayersChange{current_players_});
+    }
+    hash_ ^= current_players_hash();
     current_players_.clear();
     current_players_.push_back(player_id);
+    hash_ ^= current_players_hash();
 }
 
 void State::set_current_players(const std::vector<PlayerId>& player_ids) {
+    if (trail_.recording) {
+        record(CurrentPlayersChange{current_players_});
+    }
+    hash_ ^= current_players_hash();
     current_players_ = player_ids;
+    hash_ ^= current_players_hash();
 }
 
-Piece State::get_piece_at(const Position& position) const {
-    PieceIds piece_ids = cells_[position.cell_id()].back();
-    if (position.has_stack_id()) {
-        piece_ids = cells_[position.cell_id()][position.stack_id()];
-    }
-    std::vector<int> values = collections_[piece_ids.collection_id].model->get_values(piece_ids.piece_id);
+Piece State::get_piece_at(const Position& position, bool with_probabilities) const {
+    const Cell& cell = *cells_[position.cell_id()];
+    PieceIds piece_ids = position.has_stack_id() ? cell[position.stack_id()] : cell.back();
+    const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
+    std::vector<int> values = collection.model->get_values(piece_ids.piece_id);
     std::vector<PieceValue> piece_values;
     std::vector<double> piece_probs;
     piece_values.reserve(values.size());
-    piece_probs.reserve(values.size());
     for (int value : values) {
-        piece_values.push_back(collections_[piece_ids.collection_id].type->value_from_index(value));
-        piece_probs.push_back(collections_[piece_ids.collection_id].rbp.get_probability(piece_ids.piece_id, value));
+        piece_values.push_back(collection.type->value_from_index(value));
+    }
+    if (with_probabilities) {
+        piece_probs.reserve(values.size());
+        for (int value : values) {
+            piece_probs.push_back(collection.probability(piece_ids.piece_id, value));
+        }
     }
     return {
-        .type = collections_[piece_ids.collection_id].type,
-        .observers = collections_[piece_ids.collection_id].observers[piece_ids.piece_id],
+        .type = collection.type,
+        .observers = collection.observers[piece_ids.piece_id],
         .values = piece_values,
         .probs = piece_probs
     };
 }
 
-std::vector<Piece> State::get_pieces_at(const Position& position) const {
+std::vector<Piece> State::get_pieces_at(const Position& position, bool with_probabilities) const {
     std::vector<Piece> pieces;
-    pieces.reserve(cells_[position.cell_id()].size());
-    for (const PieceIds& piece_ids : cells_[position.cell_id()]) {
-        std::vector<int> values = collections_[piece_ids.collection_id].model->get_values(piece_ids.piece_id);
-        pieces.push_back({collections_[piece_ids.collection_id].type, collections_[piece_ids.collection_id].observers[piece_ids.piece_id], std::vector<PieceValue>()});
+    pieces.reserve(cells_[position.cell_id()]->size());
+    for (const PieceIds& piece_ids : *cells_[position.cell_id()]) {
+        const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
+        std::vector<int> values = collection.model->get_values(piece_ids.piece_id);
+        // The probabilities are only filled if asked for, the domain alone leaves `probs` empty
+        pieces.push_back({.type = collection.type, .observers = collection.observers[piece_ids.piece_id], .values = {}, .probs = {}});
         pieces.back().values.reserve(values.size());
-        pieces.back().probs.reserve(values.size());
         for (int value : values) {
-            pieces.back().values.push_back(collections_[piece_ids.collection_id].type->value_from_index(value));
-            pieces.back().probs.push_back(collections_[piece_ids.collection_id].rbp.get_probability(piece_ids.piece_id, value));
+            pieces.back().values.push_back(collection.type->value_from_index(value));
+        }
+        if (with_probabilities) {
+            pieces.back().probs.reserve(values.size());
+            for (int value : values) {
+                pieces.back().probs.push_back(collection.probability(piece_ids.piece_id, value));
+            }
         }
     }
     return pieces;
 }
 
 Variable State::variable(const std::string& name) const {
-    for (const Variable& variable : variables_) {
+    for (const Variable& variable : *variables_) {
         if (variable.name() == name) {
             return variable;
         }
@@ -412,178 +641,227 @@ Variable State::variable(const std::string& name) const {
 }
 
 void State::set_variable(const Variable& variable) {
-    for (Variable& var : variables_) {
-        if (var.name() == variable.name()) {
-            var = variable;
+    std::vector<Variable>& variables = edit_variables();
+    for (Variable& current_variable : variables) {
+        if (current_variable.name() == variable.name()) {
+            hash_ ^= seeded_hash(HashSeed::Variable, current_variable.hash()) ^ seeded_hash(HashSeed::Variable, variable.hash());
+            current_variable = variable;
             return;
         }
     }
-    variables_.push_back(variable);
+    hash_ ^= seeded_hash(HashSeed::Variable, variable.hash());
+    variables.push_back(variable);
 }
 
 void State::move_piece(const Position& from, const Position& to) {
-    put_piece_id_in_cell(to, pop_piece_id_from_cell(from));
+    // The piece never leaves the board, so the pieces off the board keep their key
+    const PieceIds piece_ids = pop_piece_id_from_cell(from);
+    put_piece_id_in_cell(to, piece_ids);
+    set_piece_cell(piece_ids, to.cell_id());
 }
 
 void State::remove_piece(const Position& from) {
-    pop_piece_id_from_cell(from);
+    set_piece_cell(pop_piece_id_from_cell(from), kOffBoard);
 }
 
 void State::remove_piece_value(const Position& from, const PieceValue& value) {
     if (from.has_stack_id()) {
-        PieceIds piece_ids = cells_[from.cell_id()][from.stack_id()];
-        collections_[piece_ids.collection_id].model->remove_value(
+        PieceIds piece_ids = (*cells_[from.cell_id()])[from.stack_id()];
+        CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.model->remove_value(
             piece_ids.piece_id,
-            collections_[piece_ids.collection_id].type->value_to_index(value)
+            collection.type->value_to_index(value)
         );
-        Gecode::SpaceStatus status = collections_[piece_ids.collection_id].model->status();
-        if (status == Gecode::SS_FAILED) {
+        if (!collection.model->propagate()) {
             std::cout << this->to_string() << std::endl;
             throw std::runtime_error("Failed to remove piece value (remove_piece_value precise)");
         }
-        collections_[piece_ids.collection_id].rbp.update_probabilities(collections_[piece_ids.collection_id].model->get_domains());
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.invalidate_probabilities();
         return;
     }
-    std::vector<int> updated_collection_ids;
-    for (const PieceIds& piece_ids : cells_[from.cell_id()]) {
-        collections_[piece_ids.collection_id].model->remove_value(
+    for (const PieceIds& piece_ids : *cells_[from.cell_id()]) {
+        CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.model->remove_value(
             piece_ids.piece_id,
-            collections_[piece_ids.collection_id].type->value_to_index(value)
+            collection.type->value_to_index(value)
         );
-        Gecode::SpaceStatus status = collections_[piece_ids.collection_id].model->status();
-        if (status == Gecode::SS_FAILED) {
+        if (!collection.model->propagate()) {
             std::cout << this->to_string() << std::endl;
             throw std::runtime_error("Failed to remove piece value (remove_piece_value)");
         }
-        updated_collection_ids.push_back(piece_ids.collection_id);
-    }
-    for (int collection_id : updated_collection_ids) {
-        collections_[collection_id].rbp.update_probabilities(collections_[collection_id].model->get_domains());
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.invalidate_probabilities();
     }
 }
 
 void State::remove_piece_values(const Position& from, const std::vector<PieceValue>& values) {
     if (from.has_stack_id()) {
-        PieceIds piece_ids = cells_[from.cell_id()][from.stack_id()];
+        PieceIds piece_ids = (*cells_[from.cell_id()])[from.stack_id()];
+        CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
+        hash_ ^= collection_hash(piece_ids.collection_id);
         for (const PieceValue& value : values) {
-            collections_[piece_ids.collection_id].model->remove_value(
+            collection.model->remove_value(
                 piece_ids.piece_id,
-                collections_[piece_ids.collection_id].type->value_to_index(value)
+                collection.type->value_to_index(value)
             );
         }
-        Gecode::SpaceStatus status = collections_[piece_ids.collection_id].model->status();
-        if (status == Gecode::SS_FAILED) {
+        if (!collection.model->propagate()) {
             std::cout << this->to_string() << std::endl;
             std::cout << "Position(" << from.cell_id() << ", " << from.stack_id() << ")\n";
             for (const auto& value : values) {
-                std::cout << collections_[piece_ids.collection_id].type->value_to_index(value) << " ";
+                std::cout << collection.type->value_to_index(value) << " ";
             }
             std::cout << "\n";
             throw std::runtime_error("Failed to remove piece value (remove_piece_values precise)");
         }
-        collections_[piece_ids.collection_id].rbp.update_probabilities(collections_[piece_ids.collection_id].model->get_domains());
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.invalidate_probabilities();
         return;
     }
-    std::vector<int> updated_collection_ids;
-    for (const PieceIds& piece_ids : cells_[from.cell_id()]) {
+    for (const PieceIds& piece_ids : *cells_[from.cell_id()]) {
+        CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
+        hash_ ^= collection_hash(piece_ids.collection_id);
         for (const PieceValue& value : values) {
-            collections_[piece_ids.collection_id].model->remove_value(
+            collection.model->remove_value(
                 piece_ids.piece_id,
-                collections_[piece_ids.collection_id].type->value_to_index(value)
+                collection.type->value_to_index(value)
             );
         }
-        Gecode::SpaceStatus status = collections_[piece_ids.collection_id].model->status();
-        if (status == Gecode::SS_FAILED) {
+        if (!collection.model->propagate()) {
             std::cout << this->to_string() << std::endl;
             std::cout << "Position(" << from.cell_id() << ")\n";
             for (const auto& value : values) {
-                std::cout << collections_[piece_ids.collection_id].type->value_to_index(value) << " ";
+                std::cout << collection.type->value_to_index(value) << " ";
             }
             std::cout << "\n";
             throw std::runtime_error("Failed to remove piece value (remove_piece_values)");
         }
-        updated_collection_ids.push_back(piece_ids.collection_id);
-    }
-    for (int collection_id : updated_collection_ids) {
-        collections_[collection_id].rbp.update_probabilities(collections_[collection_id].model->get_domains());
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.invalidate_probabilities();
     }
 }
 
 void State::assign_piece_value(const Position& from, const PieceValue& value) {
     if (from.has_stack_id()) {
-        PieceIds piece_ids = cells_[from.cell_id()][from.stack_id()];
-        collections_[piece_ids.collection_id].model->assign_value(
+        PieceIds piece_ids = (*cells_[from.cell_id()])[from.stack_id()];
+        CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.model->assign_value(
             piece_ids.piece_id,
-            collections_[piece_ids.collection_id].type->value_to_index(value)
+            collection.type->value_to_index(value)
         );
-        Gecode::SpaceStatus status = collections_[piece_ids.collection_id].model->status();
-        if (status == Gecode::SS_FAILED) {
+        if (!collection.model->propagate()) {
             throw std::runtime_error("Failed to assign piece value");
         }
-        collections_[piece_ids.collection_id].rbp.update_probabilities(collections_[piece_ids.collection_id].model->get_domains());
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.invalidate_probabilities();
         return;
     }
-    std::vector<int> updated_collection_ids;
-    for (const PieceIds& piece_ids : cells_[from.cell_id()]) {
-        collections_[piece_ids.collection_id].model->assign_value(
+    for (const PieceIds& piece_ids : *cells_[from.cell_id()]) {
+        CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.model->assign_value(
             piece_ids.piece_id,
-            collections_[piece_ids.collection_id].type->value_to_index(value)
+            collection.type->value_to_index(value)
         );
-        Gecode::SpaceStatus status = collections_[piece_ids.collection_id].model->status();
-        if (status == Gecode::SS_FAILED) {
+        if (!collection.model->propagate()) {
             throw std::runtime_error("Failed to assign piece value");
         }
-        updated_collection_ids.push_back(piece_ids.collection_id);
+        hash_ ^= collection_hash(piece_ids.collection_id);
+        collection.invalidate_probabilities();
+    }
+}
+
+void State::assign_piece_values(const Position& from, const std::vector<PieceValue>& values) {
+    if (from.has_stack_id()) {
+        if (values.size() != 1) {
+            throw std::invalid_argument("A single value is assigned to a piece");
+        }
+        assign_piece_value(from, values[0]);
+        return;
     }
-    for (int collection_id : updated_collection_ids) {
-        collections_[collection_id].rbp.update_probabilities(collections_[collection_id].model->get_domains());
+    if (values.size() != cells_[from.cell_id()]->size()) {
+        throw std::invalid_argument("There must be one value per piece of the cell");
     }
+    for (std::size_t stack_id = 0; stack_id < values.size(); stack_id++) {
+        assign_piece_value(Position(from.cell_id(), static_cast<int>(stack_id)), values[stack_id]);
+    }
+}
+
+std::vector<PieceValue> State::draw_piece_values(const Position& from, std::mt19937& generator) {
+    std::vector<PieceValue> values;
+    const int first = from.has_stack_id() ? from.stack_id() : 0;
+    const int last = from.has_stack_id() ? from.stack_id() + 1 : static_cast<int>(cells_[from.cell_id()]->size());
+    values.reserve(last - first);
+    for (int stack_id = first; stack_id < last; stack_id++) {
+        // Earlier assignments may have ruled values out
+        const Piece piece = get_piece_at(Position(from.cell_id(), stack_id), false);
+        std::uniform_int_distribution<std::size_t> distribution(0, piece.values.size() - 1);
+        values.push_back(piece.values[distribution(generator)]);
+        assign_piece_value(Position(from.cell_id(), stack_id), values.back());
+    }
+    return values;
 }
 
 bool State::add_observers(const Position& from, const std::vector<PlayerId>& observers) {
+    hash_ ^= cell_hash(from.cell_id());
     if (from.has_stack_id()) {
-        PieceIds piece_id = cells_[from.cell_id()][from.stack_id()];
-        std::vector<PlayerId>& last_observers = collections_[piece_id.collection_id].observers[piece_id.piece_id];
+        PieceIds piece_id = (*cells_[from.cell_id()])[from.stack_id()];
+        CollectionWrapper& collection = edit_collection(piece_id.collection_id);
+        std::vector<PlayerId>& last_observers = collection.observers[piece_id.piece_id];
         last_observers.insert(last_observers.end(), observers.begin(), observers.end());
         std::sort(last_observers.begin(), last_observers.end());
         last_observers.erase(std::unique(last_observers.begin(), last_observers.end()), last_observers.end());
     } else {
-        for (const PieceIds& piece_id : cells_[from.cell_id()]) {
-            std::vector<PlayerId>& last_observers = collections_[piece_id.collection_id].observers[piece_id.piece_id];
+        for (const PieceIds& piece_id : *cells_[from.cell_id()]) {
+            CollectionWrapper& collection = edit_collection(piece_id.collection_id);
+            std::vector<PlayerId>& last_observers = collection.observers[piece_id.piece_id];
             last_observers.insert(last_observers.end(), observers.begin(), observers.end());
             std::sort(last_observers.begin(), last_observers.end());
             last_observers.erase(std::unique(last_observers.begin(), last_observers.end()), last_observers.end());
         }
     }
+    hash_ ^= cell_hash(from.cell_id());
     return is_seen(observers);
 }
 
 void State::remove_observers(const Position& from, const std::vector<PlayerId>& observers) {
+    hash_ ^= cell_hash(from.cell_id());
     if (from.has_stack_id()) {
-        PieceIds piece_ids = cells_[from.cell_id()][from.stack_id()];
-        std::vector<PlayerId> new_observers;
-        std::vector<PlayerId>& old_observers = collections_[piece_ids.collection_id].observers[piece_ids.piece_id];
-        std::set_difference(old_observers.begin(), old_observers.end(), observers.begin(), observers.end(), std::back_inserter(new_observers));
-        old_observers = new_observers;
-        return;
-    }
-    for (const PieceIds& piece_id : cells_[from.cell_id()]) {
+        PieceIds piece_ids = (*cells_[from.cell_id()])[from.stack_id()];
+        CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
         std::vector<PlayerId> new_observers;
-        std::vector<PlayerId>& old_observers = collections_[piece_id.collection_id].observers[piece_id.piece_id];
+        std::vector<PlayerId>& old_observers = collection.observers[piece_ids.piece_id];
         std::set_difference(old_observers.begin(), old_observers.end(), observers.begin(), observers.end(), std::back_inserter(new_observers));
         old_observers = new_observers;
+    } else {
+        for (const PieceIds& piece_id : *cells_[from.cell_id()]) {
+            CollectionWrapper& collection = edit_collection(piece_id.collection_id);
+            std::vector<PlayerId> new_observers;
+            std::vector<PlayerId>& old_observers = collection.observers[piece_id.piece_id];
+            std::set_difference(old_observers.begin(), old_observers.end(), observers.begin(), observers.end(), std::back_inserter(new_observers));
+            old_observers = new_observers;
+        }
     }
+    hash_ ^= cell_hash(from.cell_id());
 }
 
 void State::hide(const Position& from) {
+    hash_ ^= cell_hash(from.cell_id());
     if (from.has_stack_id()) {
-        const PieceIds& piece_ids = cells_[from.cell_id()][from.stack_id()];
-        collections_[piece_ids.collection_id].observers[piece_ids.piece_id] = {};
+        const PieceIds& piece_ids = (*cells_[from.cell_id()])[from.stack_id()];
+        CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
+        collection.observers[piece_ids.piece_id] = {};
     } else {
-        for (const PieceIds& piece_ids : cells_[from.cell_id()]) {
-            collections_[piece_ids.collection_id].observers[piece_ids.piece_id] = {};
+        for (const PieceIds& piece_ids : *cells_[from.cell_id()]) {
+            CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
+            collection.observers[piece_ids.piece_id] = {};
         }
     }
+    hash_ ^= cell_hash(from.cell_id());
 }
 
 void State::shuffle(const Position& from) {
@@ -592,8 +870,8 @@ void State::shuffle(const Position& from) {
     }
 
     std::unordered_map<std::shared_ptr<const PieceType>, std::vector<int>> counts;
-    for (PieceIds piece_ids : cells_[from.cell_id()]) {
-        const CollectionWrapper& collection = collections_[piece_ids.collection_id];
+    for (PieceIds piece_ids : *cells_[from.cell_id()]) {
+        const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
         const std::vector<PlayerId>& observers = collection.observers[piece_ids.piece_id];
 
         if (is_seen(observers)) {
@@ -615,14 +893,14 @@ void State::shuffle(const Position& from) {
     std::vector<std::unique_ptr<CollectionModel>> new_models;
     new_models.reserve(collections_.size());
     for (const auto& collection : collections_) {
-        new_models.emplace_back(dynamic_cast<CollectionModel*>(collection.original_model->clone()));
+        new_models.push_back(collection->original_model->clone_model());
     }
     const int cells_size = static_cast<int>(cells_.size());
     for (int cell_id = 0; cell_id < cells_size; cell_id++) {
         if (cell_id == from.cell_id()) {
-            for (const PieceIds& piece_ids : cells_[cell_id]) {
+            for (const PieceIds& piece_ids : *cells_[cell_id]) {
 
-                const CollectionWrapper& collection = collections_[piece_ids.collection_id];
+                const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
                 const std::vector<PlayerId>& observers = collection.observers[piece_ids.piece_id];
 
                 if (is_seen(observers)) {
@@ -638,8 +916,8 @@ void State::shuffle(const Position& from) {
                 }
             }
         } else {
-            for (const PieceIds& piece_ids : cells_[cell_id]) {
-                const CollectionWrapper& collection = collections_[piece_ids.collection_id];
+            for (const PieceIds& piece_ids : *cells_[cell_id]) {
+                const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
                 std::unique_ptr<CollectionModel>& new_model = new_models[piece_ids.collection_id];
                 std::vector<bool> can_be_values = collection.model->get_domain(piece_ids.piece_id);
                 for (int value = 0; value < can_be_values.size(); value++) {
@@ -652,96 +930,119 @@ void State::shuffle(const Position& from) {
     }
 
     for (auto& new_model : new_models) {
-        Gecode::SpaceStatus status = new_model->status();
-        if (status == Gecode::SS_FAILED) {
+        if (!new_model->propagate()) {
             throw std::logic_error("Cannot shuffle correctly");
         }
     }
 
     for (int collection_id = 0; collection_id < new_models.size(); collection_id++) {
-        collections_[collection_id].model = std::move(new_models[collection_id]);
-    }
-
-    for (auto& collection : collections_) {
-        collection.rbp.update_probabilities(collection.model->get_domains());
+        CollectionWrapper& collection = edit_collection(collection_id);
+        hash_ ^= collection_hash(collection_id);
+        collection.model = std::move(new_models[collection_id]);
+        hash_ ^= collection_hash(collection_id);
+        collection.invalidate_probabilities();
     }
 }
 
 bool State::assignment_possible(const Position& from, const std::vector<PieceValue>& not_values) const {
-    // TODO !! 
-    if (from.has_stack_id()) { // Ça c'est moche quand même
-        const PieceIds& piece_ids = cells_[from.cell_id()][from.stack_id()];
-        CollectionWrapper collection_copy = collections_[piece_ids.collection_id];
+    // Only the constraint models are copied, the belief propagation buffers are not needed
+    if (from.has_stack_id()) {
+        const PieceIds& piece_ids = (*cells_[from.cell_id()])[from.stack_id()];
+        const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
+        std::unique_ptr<CollectionModel> model_copy = collection.model->clone_model();
         for (const PieceValue& value : not_values) {
-            collection_copy.model->remove_value(
-                piece_ids.piece_id,
-                collection_copy.type->value_to_index(value)
-            );
-        }
-        Gecode::SpaceStatus status = collection_copy.model->status();
-        if (status == Gecode::SS_FAILED) {
-            return false;
+            model_copy->remove_value(piece_ids.piece_id, collection.type->value_to_index(value));
         }
-        Gecode::DFS<CollectionModel> dfs(collection_copy.model.get());
-        if (dfs.next()) {
-            return true;
-        } else {
-            return false;
+        return model_copy->has_solution();
+    }
+    std::unordered_map<int, std::unique_ptr<CollectionModel>> model_copies;
+    for (const PieceIds& piece_ids : *cells_[from.cell_id()]) {
+        const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
+        if (!model_copies.contains(piece_ids.collection_id)) {
+            model_copies.emplace(piece_ids.collection_id, collection.model->clone_model());
         }
-    } else {
-        std::unordered_map<int, CollectionWrapper> collection_copies;
-        for (const PieceIds& piece_ids : cells_[from.cell_id()]) {
-            if (!collection_copies.contains(piece_ids.collection_id)) {
-                collection_copies.emplace(piece_ids.collection_id, collections_[piece_ids.collection_id]);
-            }
-            CollectionWrapper& collection_copy = collection_copies.at(piece_ids.collection_id);
-            for (const PieceValue& value : not_values) {
-                collection_copy.model->remove_value(
-                    piece_ids.piece_id,
-                    collection_copy.type->value_to_index(value)
-                );
-            }
+        std::unique_ptr<CollectionModel>& model_copy = model_copies.at(piece_ids.collection_id);
+        for (const PieceValue& value : not_values) {
+            model_copy->remove_value(piece_ids.piece_id, collection.type->value_to_index(value));
         }
-        for (const auto& [_, collection_copy] : collection_copies) {
-            Gecode::SpaceStatus status = collection_copy.model->status();
-            if (status == Gecode::SS_FAILED) {
-                return false;
-            }
-            Gecode::DFS<CollectionModel> dfs(collection_copy.model.get());
-            if (!dfs.next()) {
-                return false;
-            }
+    }
+    for (const auto& [_, model_copy] : model_copies) {
+        if (!model_copy->has_solution()) {
+            return false;
         }
-        return true;
     }
-    return false;
+    return true;
 }
 
 bool State::is_consistent_with(const State& other) const {
     for (int cell_id = 0; cell_id < cells_.size(); cell_id++) {
-        if (cells_[cell_id].size() != other.cells_[cell_id].size()) {
+        const Cell& cell = *cells_[cell_id];
+        const Cell& other_cell = *other.cells_[cell_id];
+        if (cell.size() != other_cell.size()) {
             return false;
         }
 
-        for (int stack_id = 0; stack_id < cells_[cell_id].size(); stack_id++) {
-            if (cells_[cell_id][stack_id].collection_id != other.cells_[cell_id][stack_id].collection_id) {
+        for (int stack_id = 0; stack_id < cell.size(); stack_id++) {
+            if (cell[stack_id].collection_id != other_cell[stack_id].collection_id) {
                 return false;
             }
-            PieceIds piece_ids = cells_[cell_id][stack_id];
-            std::vector<bool> can_be_value = collections_[piece_ids.collection_id].model->get_domain(piece_ids.piece_id);
-            PieceIds other_piece_ids = other.cells_[cell_id][stack_id];
-            std::vector<bool> other_can_be_value = other.collections_[other_piece_ids.collection_id].model->get_domain(other_piece_ids.piece_id);
+            PieceIds piece_ids = cell[stack_id];
+            const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
+            std::vector<bool> can_be_value = collection.model->get_domain(piece_ids.piece_id);
+            PieceIds other_piece_ids = other_cell[stack_id];
+            const CollectionWrapper& other_collection = *other.collections_[other_piece_ids.collection_id];
+            std::vector<bool> other_can_be_value = other_collection.model->get_domain(other_piece_ids.piece_id);
             for (int value_id = 0; value_id < can_be_value.size(); value_id++) {
                 if (!can_be_value[value_id] && other_can_be_value[value_id]) {
                     return false;
                 }
             }
-            if (collections_[piece_ids.collection_id].observers[piece_ids.piece_id] != other.collections_[other_piece_ids.collection_id].observers[other_piece_ids.piece_id]) {
+            if (collection.observers[piece_ids.piece_id] != other_collection.observers[other_piece_ids.piece_id]) {
+                return false;
+            }
+        }
+    }
+    return *variables_ == *other.variables_ && current_players_ == other.current_players_;
+}
+
+std::uint64_t State::hash() const {
+    return hash_;
+}
+
+bool State::operator==(const State& other) const {
+    if (hash_ != other.hash_
+        || point_of_view_.type != other.point_of_view_.type
+        || point_of_view_.player_id != other.point_of_view_.player_id
+        || current_players_ != other.current_players_
+        || cells_.size() != other.cells_.size()) {
+        return false;
+    }
+    for (std::size_t cell_id = 0; cell_id < cells_.size(); cell_id++) {
+        const Cell& cell = *cells_[cell_id];
+        const Cell& other_cell = *other.cells_[cell_id];
+        if (cell.size() != other_cell.size()) {
+            return false;
+        }
+        for (std::size_t stack_id = 0; stack_id < cell.size(); stack_id++) {
+            PieceIds piece_ids = cell[stack_id];
+            PieceIds other_piece_ids = other_cell[stack_id];
+            if (piece_ids.collection_id != other_piece_ids.collection_id) {
+                return false;
+            }
+            const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
+            const CollectionWrapper& other_collection = *other.collections_[other_piece_ids.collection_id];
+            if (collection.observers[piece_ids.piece_id] != other_collection.observers[other_piece_ids.piece_id]
+                || collection.model->get_values(piece_ids.piece_id) != other_collection.model->get_values(other_piece_ids.piece_id)) {
                 return false;
             }
         }
     }
-    return variables_ == other.variables_ && current_players_ == other.current_players_;
+    for (int collection_id = 0; collection_id < static_cast<int>(collections_.size()); collection_id++) {
+        if (off_board_pieces(collection_id) != other.off_board_pieces(collection_id)) {
+            return false;
+        }
+    }
+    return variables_.shares_with(other.variables_) || *variables_ == *other.variables_;
 }
 
 std::string State::to_string() const {
@@ -755,7 +1056,7 @@ std::string State::to_string() const {
     s += "    Cells: \n";
     for (int i = 0; i < cells_.size(); i++) {
         s += "        Cell " + std::to_string(i) + ": ";
-        for (const PieceIds& piece_ids : cells_[i]) {
+        for (const PieceIds& piece_ids : *cells_[i]) {
             s += "(" + std::to_string(piece_ids.collection_id) + ", " + std::to_string(piece_ids.piece_id) + ") ";
         }
         s += "\n";
@@ -763,23 +1064,24 @@ std::string State::to_string() const {
     s += "    Collections: \n";
     for (int collection_id = 0; collection_id < collections_.size(); collection_id++) {
         s += "        Collection " + std::to_string(collection_id) + ": \n";
-        for (int piece_id = 0; piece_id < collections_[collection_id].observers.size(); piece_id++) {
+        const CollectionWrapper& collection = *collections_[collection_id];
+        for (int piece_id = 0; piece_id < collection.observers.size(); piece_id++) {
             s += "            Piece " + std::to_string(piece_id) + ": \n";
-            std::vector<int> values = collections_[collection_id].model->get_values(piece_id);
+            std::vector<int> values = collection.model->get_values(piece_id);
             s += "                Domain: ";
             for (int value: values) {
-                s += std::to_string(value) + "(" + std::to_string(collections_[collection_id].rbp.get_probability(piece_id, value)) + ") ";
+                s += std::to_string(value) + "(" + std::to_string(collection.probability(piece_id, value)) + ") ";
             }
             s += "\n";
             s += "                Observers: ";
-            for (PlayerId observer : collections_[collection_id].observers[piece_id]) {
+            for (PlayerId observer : collection.observers[piece_id]) {
                 s += std::to_string(observer) + " ";
             }
             s += "\n";
         }
     }
     s += "    Variables: \n";
-    for (const Variable& variable : variables_) {
+    for (const Variable& variable : *variables_) {
         s += "       " + variable.to_string() + "\n";
     }
     return s;
@@ -802,29 +1104,199 @@ bool State::is_seen(const std::vector<PlayerId>& observers) const {
     return false;
 }
 
-State::PieceIds State::pop_piece_id_from_cell(const Position& position) {
-    if (position.has_stack_id()) {
-        PieceIds piece_id = cells_[position.cell_id()][position.stack_id()];
-        cells_[position.cell_id()].erase(cells_[position.cell_id()].begin() + position.stack_id());
-        return piece_id;
+std::uint64_t State::point_of_view_hash() const {
+    return hash_combine(seeded_hash(HashSeed::PointOfView, static_cast<std::uint64_t>(point_of_view_.type)), point_of_view_.player_id);
+}
+
+std::uint64_t State::current_players_hash() const {
+    std::uint64_t hash = seeded_hash(HashSeed::CurrentPlayers, current_players_.size());
+    for (PlayerId player_id : current_players_) {
+        hash = hash_combine(hash, player_id);
+    }
+    return hash;
+}
+
+std::uint64_t State::piece_hash(PieceIds piece_ids) const {
+    const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
+    std::uint64_t hash = hash_combine(seeded_hash(HashSeed::Piece, piece_ids.collection_id), collection.model->domain_hash(piece_ids.piece_id));
+    for (PlayerId observer : collection.observers[piece_ids.piece_id]) {
+        hash = hash_combine(hash, observer);
+    }
+    return hash;
+}
+
+std::uint64_t State::cell_hash(int cell_id) const {
+    std::uint64_t hash = seeded_hash(HashSeed::Cell, cell_id);
+    for (const PieceIds& piece_ids : *cells_[cell_id]) {
+        hash = hash_combine(hash, piece_hash(piece_ids));
+    }
+    return hash;
+}
+
+std::uint64_t State::off_board_hash(int collection_id) const {
+    // Summing rather than XORing the pieces keeps two equal pieces from cancelling out
+    std::uint64_t sum = 0;
+    const std::vector<int>& piece_cells = *piece_cells_[collection_id];
+    for (int piece_id = 0; piece_id < static_cast<int>(piece_cells.size()); piece_id++) {
+        if (piece_cells[piece_id] == kOffBoard) {
+            sum += piece_hash(PieceIds{collection_id, piece_id});
+        }
+    }
+    return hash_combine(seeded_hash(HashSeed::OffBoard, collection_id), sum);
+}
+
+std::uint64_t State::collection_hash(int collection_id) const {
+    // A cell holding several pieces of the collection is only hashed once. Pieces are spread over
+    // few cells, so the cells already hashed are searched linearly.
+    std::vector<int> cell_ids;
+    std::uint64_t hash = off_board_hash(collection_id);
+    for (int cell_id : *piece_cells_[collection_id]) {
+        if (cell_id != kOffBoard && std::ranges::find(cell_ids, cell_id) == cell_ids.end()) {
+            cell_ids.push_back(cell_id);
+            hash ^= cell_hash(cell_id);
+        }
+    }
+    return hash;
+}
+
+std::vector<std::pair<std::vector<int>, std::vector<PlayerId>>> State::off_board_pieces(int collection_id) const {
+    std::vector<std::pair<std::vector<int>, std::vector<PlayerId>>> pieces;
+    const CollectionWrapper& collection = *collections_[collection_id];
+    const std::vector<int>& piece_cells = *piece_cells_[collection_id];
+    for (int piece_id = 0; piece_id < static_cast<int>(piece_cells.size()); piece_id++) {
+        if (piece_cells[piece_id] == kOffBoard) {
+            pieces.emplace_back(collection.model->get_values(piece_id), collection.observers[piece_id]);
+        }
+    }
+    std::sort(pieces.begin(), pieces.end());
+    return pieces;
+}
+
+std::uint64_t State::compute_hash() const {
+    std::uint64_t hash = point_of_view_hash() ^ current_players_hash();
+    for (int cell_id = 0; cell_id < static_cast<int>(cells_.size()); cell_id++) {
+        hash ^= cell_hash(cell_id);
+    }
+    for (int collection_id = 0; collection_id < static_cast<int>(collections_.size()); collection_id++) {
+        hash ^= off_board_hash(collection_id);
+    }
+    for (const Variable& variable : *variables_) {
+        hash ^= seeded_hash(HashSeed::Variable, variable.hash());
     }
-    PieceIds piece_id = cells_[position.cell_id()].back();
-    cells_[position.cell_id()].pop_back();
+    return hash;
+}
+
+State::PieceIds State::pop_piece_id_from_cell(const Position& position) {
+    Cell& cell = edit_cell(position.cell_id());
+    hash_ ^= cell_hash(position.cell_id());
+    std::size_t stack_id = position.has_stack_id() ? static_cast<std::size_t>(position.stack_id()) : cell.size() - 1;
+    PieceIds piece_id = cell[stack_id];
+    cell.erase(cell.begin() + static_cast<std::ptrdiff_t>(stack_id));
+    hash_ ^= cell_hash(position.cell_id());
     return piece_id;
 }
 
 void State::put_piece_id_in_cell(const Position& position, PieceIds piece_id) {
-    if (position.has_stack_id()) {
-        cells_[position.cell_id()].insert(cells_[position.cell_id()].begin() + position.stack_id(), piece_id);
-    } else {
-        cells_[position.cell_id()].push_back(piece_id);
+    Cell& cell = edit_cell(position.cell_id());
+    hash_ ^= cell_hash(position.cell_id());
+    std::size_t stack_id = position.has_stack_id() ? static_cast<std::size_t>(position.stack_id()) : cell.size();
+    cell.insert(cell.begin() + static_cast<std::ptrdiff_t>(stack_id), piece_id);
+    hash_ ^= cell_hash(position.cell_id());
+}
+
+void State::set_piece_cell(PieceIds piece_ids, int cell_id) {
+    int& piece_cell = piece_cells_[piece_ids.collection_id].write()[piece_ids.piece_id];
+    if (trail_.recording) {
+        record(PieceCellChange{piece_ids, piece_cell});
+    }
+    const bool leaves_or_enters_board = (piece_cell == kOffBoard) != (cell_id == kOffBoard);
+    if (leaves_or_enters_board) {
+        hash_ ^= off_board_hash(piece_ids.collection_id);
+    }
+    piece_cell = cell_id;
+    if (leaves_or_enters_board) {
+        hash_ ^= off_board_hash(piece_ids.collection_id);
+    }
+}
+
+State::Trail& State::Trail::operator=(const Trail& /*other*/) {
+    *this = Trail();
+    return *this;
+}
+
+State::Cell& State::edit_cell(int cell_id) {
+    if (trail_.recording && trail_.cell_stamps[cell_id] != trail_.current) {
+        record(CellChange{cell_id, cells_[cell_id], trail_.cell_stamps[cell_id]});
+        trail_.cell_stamps[cell_id] = trail_.current;
+    }
+    return cells_[cell_id].write();
+}
+
+CollectionWrapper& State::edit_collection(int collection_id) {
+    if (trail_.recording && trail_.collection_stamps[collection_id] != trail_.current) {
+        record(CollectionChange{collection_id, collections_[collection_id], trail_.collection_stamps[collection_id]});
+        trail_.collection_stamps[collection_id] = trail_.current;
+    }
+    return collections_[collection_id].write();
+}
+
+std::vector<Variable>& State::edit_variables() {
+    if (trail_.recording && trail_.variables_stamp != trail_.current) {
+        record(VariablesChange{variables_, trail_.variables_stamp});
+        trail_.variables_stamp = trail_.current;
+    }
+    return variables_.write();
+}
+
+void State::record(TrailEntry entry) {
+    trail_.entries.push_back(std::move(entry));
+}
+
+State::Checkpoint State::checkpoint() {
+    // Rolling back to the first checkpoint resets the stamps, they only need to be made once
+    trail_.recording = true;
+    trail_.cell_stamps.resize(cells_.size(), 0);
+    trail_.collection_stamps.resize(collections_.size(), 0);
+    Checkpoint checkpoint = trail_.entries.size();
+    // The hash is restored as a whole rather than undone along with each component
+    record(HashChange{hash_, trail_.current});
+    trail_.current = ++trail_.last;
+    return checkpoint;
+}
+
+void State::rollback(Checkpoint checkpoint) {
+    while (trail_.entries.size() > checkpoint) {
+        std::visit([this](auto& entry) {
+            using Entry = std::decay_t<decltype(entry)>;
+            if constexpr (std::is_same_v<Entry, HashChange>) {
+                hash_ = entry.hash;
+                trail_.current = entry.stamp;
+            } else if constexpr (std::is_same_v<Entry, CurrentPlayersChange>) {
+                current_players_ = std::move(entry.players);
+            } else if constexpr (std::is_same_v<Entry, CellChange>) {
+                cells_[entry.cell_id] = std::move(entry.cell);
+                trail_.cell_stamps[entry.cell_id] = entry.stamp;
+            } else if constexpr (std::is_same_v<Entry, CollectionChange>) {
+                collections_[entry.collection_id] = std::move(entry.collection);
+                trail_.collection_stamps[entry.collection_id] = entry.stamp;
+            } else if constexpr (std::is_same_v<Entry, VariablesChange>) {
+                variables_ = std::move(entry.variables);
+                trail_.variables_stamp = entry.stamp;
+            } else if constexpr (std::is_same_v<Entry, PieceCellChange>) {
+                piece_cells_[entry.piece_ids.collection_id].write()[entry.piece_ids.piece_id] = entry.cell_id;
+            }
+        }, trail_.entries.back());
+        trail_.entries.pop_back();
+    }
+    if (checkpoint == 0) {
+        trail_.recording = false;
     }
 }
 
 StateBuilder::StateBuilder(std::shared_ptr<const Game> game, const PointOfView& point_of_view) {
     state_.game_ = std::move(game);
     state_.point_of_view_ = point_of_view;
-    state_.cells_ = std::vector<std::vector<State::PieceIds>>(state_.game_->play_graph().size());
+    state_.cells_ = std::vector<CopyOnWrite<State::Cell>>(state_.game_->play_graph().size());
 }
 
 StateBuilder& StateBuilder::set_initial_players(const std::vector<PlayerId>& player_ids) {
@@ -863,37 +1335,39 @@ State StateBuilder::build() {
 
     int type_id = 0;
     for (const auto& [type, pieces] : piece_map) {
-        state_.collections_.emplace_back(type, pieces.size(), piece_count[type]);
+        state_.collections_.emplace_back(std::in_place, type, pieces.size(), piece_count[type]);
+        CollectionWrapper& collection = state_.collections_.back().write();
+        std::vector<int>& piece_cells = state_.piece_cells_.emplace_back(std::in_place, pieces.size(), State::kOffBoard).write();
 
         for (int piece_id = 0; piece_id < pieces.size(); piece_id++) {
-            state_.collections_.back().observers[piece_id] = pieces[piece_id].observers;
+            collection.observers[piece_id] = pieces[piece_id].observers;
             if (state_.is_seen(pieces[piece_id].observers)) {
-                state_.collections_.back().model->assign_value(piece_id, type->value_to_index(pieces[piece_id].value));
+                collection.model->assign_value(piece_id, type->value_to_index(pieces[piece_id].value));
             }
-            state_.cells_[pieces[piece_id].position.cell_id()].push_back({type_id, piece_id});
+            state_.cells_[pieces[piece_id].position.cell_id()].write().push_back({type_id, piece_id});
+            piece_cells[piece_id] = pieces[piece_id].position.cell_id();
         }
-        state_.collections_.back().original_model->status();
-        Gecode::SpaceStatus status = state_.collections_.back().model->status();
-        if (status == Gecode::SS_FAILED) {
+        if (!collection.model->propagate()) {
             throw std::runtime_error("Failed to create collection");
         }
-        state_.collections_.back().rbp.update_probabilities(state_.collections_.back().model->get_domains());
+        collection.invalidate_probabilities();
         type_id++;
     }
+    state_.hash_ = state_.compute_hash();
 
     return state_;
 }
 
 bool State::is_determined() const {
     for (const auto& collection : collections_) {
-        if (collection.model->status() != Gecode::SS_SOLVED) {
+        if (!collection->model->is_solved()) {
             return false;
         }
     }
     return true;
 }
 
-double State::determinize(std::mt19937& generator) {
+double State::determinize(std::mt19937& generator, bool with_probability) {
 
     if (is_determined()) {
         return 1.0;
@@ -901,27 +1375,26 @@ double State::determinize(std::mt19937& generator) {
 
     double total_probability = 1.0;
 
-    for (const auto& pieces : cells_) {
-        for (const auto& piece_ids : pieces) {
-            CollectionWrapper& collection = collections_[piece_ids.collection_id];
-            std::vector<int> values = collection.model->get_values(piece_ids.piece_id);
+    for (const auto& cell : cells_) {
+        for (const auto& piece_ids : *cell) {
+            std::vector<int> values = collections_[piece_ids.collection_id]->model->get_values(piece_ids.piece_id);
             if (values.size() > 1) {
                 std::uniform_int_distribution<std::size_t> dist(0, values.size()-1);
                 int value = values[dist(generator)];
-                total_probability *= collection.rbp.get_probability(piece_ids.piece_id, value);
+                if (with_probability) {
+                    total_probability *= collections_[piece_ids.collection_id]->probability(piece_ids.piece_id, value);
+                }
+                CollectionWrapper& collection = edit_collection(piece_ids.collection_id);
                 collection.model->assign_value(piece_ids.piece_id, value);
-                Gecode::SpaceStatus status = collection.model->status();
-                if (status == Gecode::SS_FAILED) {
+                if (!collection.model->propagate()) {
                     throw std::logic_error("Cannot determinize state.");
                 }
-                collection.rbp.update_probabilities(collection.model->get_domains());
+                collection.invalidate_probabilities();
             }
         }
     }
-
-    for (auto& collection : collections_) {
-        collection.rbp.update_probabilities(collection.model->get_domains());
-    }
+    // Most pieces change, so the hash is recomputed once rather than updated after each of them
+    hash_ = compute_hash();
 
     return total_probability;
 }
@@ -931,16 +1404,16 @@ double State::determinize_with_marginals(std::mt19937& generator) {
     while (!is_determined()) {
         PieceIds max_piece_ids(0, 0);
         double max_prob = -1.0;
-        for (const auto& pieces : cells_) {
-            for (const auto& piece_ids : pieces) {
-                CollectionWrapper& collection = collections_[piece_ids.collection_id];
+        for (const auto& cell : cells_) {
+            for (const auto& piece_ids : *cell) {
+                const CollectionWrapper& collection = *collections_[piece_ids.collection_id];
                 std::vector<int> values = collection.model->get_values(piece_ids.piece_id);
                 if (values.size() <= 1) {
                     continue;
                 }
                 double current_max_prob = -1.0;
                 for (int value : values) {
-                    current_max_prob = std::max(current_max_prob, collection.rbp.get_probability(piece_ids.piece_id, value));
+                    current_max_prob = std::max(current_max_prob, collection.probability(piece_ids.piece_id, value));
                 }
                 if (current_max_prob > max_prob) {
                     max_prob = current_max_prob;
@@ -953,26 +1426,27 @@ double State::determinize_with_marginals(std::mt19937& generator) {
             throw std::logic_error("Cannot find a piece to determinized while the state is not determined");
         }
 
-        CollectionWrapper& collection = collections_[max_piece_ids.collection_id];
-        std::vector<int> values = collection.model->get_values(max_piece_ids.piece_id);
+        const CollectionWrapper& max_collection = *collections_[max_piece_ids.collection_id];
+        std::vector<int> values = max_collection.model->get_values(max_piece_ids.piece_id);
         std::vector<double> probs;
         probs.reserve(values.size());
         for (int value : values) {
-            probs.push_back(collection.rbp.get_probability(max_piece_ids.piece_id, value));
+            probs.push_back(max_collection.probability(max_piece_ids.piece_id, value));
         }
         std::discrete_distribution<int> dist(probs.begin(), probs.end());
         int value = values[dist(generator)];
 
-        total_probability *= collection.rbp.get_probability(max_piece_ids.piece_id, value);
+        total_probability *= max_collection.probability(max_piece_ids.piece_id, value);
 
+        CollectionWrapper& collection = edit_collection(max_piece_ids.collection_id);
         collection.model->assign_value(max_piece_ids.piece_id, value);
-        Gecode::SpaceStatus status = collection.model->status();
-        if (status == Gecode::SS_FAILED) {
+        if (!collection.model->propagate()) {
             throw std::logic_error("Cannot determinize state.");
         }
-        collection.rbp.update_probabilities(collection.model->get_domains());
+        collection.invalidate_probabilities();
 
     }
+    hash_ = compute_hash();
     return total_probability;
 }
 
@@ -0,0 +1,118 @@
+#include "Belief-SG/core/thread_pool.h"
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace belief_sg {
+
+ThreadPool::ThreadPool(int n_threads) {
+    if (n_threads < 1) {
+        throw std::invalid_argument("A thread pool needs at least one thread");
+    }
+    queues_.reserve(n_threads);
+    for (int i = 0; i < n_threads; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    workers_.reserve(n_threads);
+    for (int i = 0; i < n_threads; i++) {
+        workers_.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    batch_started_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+int ThreadPool::size() const {
+    return static_cast<int>(workers_.size());
+}
+
+void ThreadPool::parallel_for(int n_tasks, const std::function<void(int)>& task) {
+    if (n_tasks <= 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_ = &task;
+    n_pending_ = n_tasks;
+    // Contiguous ranges, so that neighbouring tasks run on the same worker unless stolen
+    const int n_workers = size();
+    for (int worker_id = 0; worker_id < n_workers; worker_id++) {
+        Queue& queue = *queues_[worker_id];
+        std::lock_guard<std::mutex> queue_lock(queue.mutex);
+        for (int i = n_tasks * worker_id / n_workers; i < n_tasks * (worker_id + 1) / n_workers; i++) {
+            queue.tasks.push_back(i);
+        }
+    }
+    batch_++;
+    batch_started_.notify_all();
+    batch_done_.wait(lock, [this] { return n_pending_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void ThreadPool::work(int worker_id) {
+    std::uint64_t last_batch = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            batch_started_.wait(lock, [&] { return stopping_ || batch_ != last_batch; });
+            if (stopping_) {
+                return;
+            }
+            last_batch = batch_;
+        }
+        while (run_task(worker_id)) {}
+    }
+}
+
+bool ThreadPool::run_task(int worker_id) {
+    int task_id = -1;
+    const int n_workers = size();
+    for (int offset = 0; offset < n_workers && task_id < 0; offset++) {
+        Queue& queue = *queues_[(worker_id + offset) % n_workers];
+        std::lock_guard<std::mutex> queue_lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        // The owner works from the front of its range, thieves take from the back
+        if (offset == 0) {
+            task_id = queue.tasks.front();
+            queue.tasks.pop_front();
+        } else {
+            task_id = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+    }
+    if (task_id < 0) {
+        return false;
+    }
+    try {
+        (*task_)(task_id);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) {
+            error_ = std::current_exception();
+        }
+    }
+    if (n_pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch_done_.notify_all();
+    }
+    return true;
+}
+
+}  // namespace belief_sg
@@ -0,0 +1,135 @@
+#include "Belief-SG/core/tournament.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Belief-SG/core/agent.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/game_record.h"
+#include "Belief-SG/core/manager.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/seeding.h"
+
+namespace belief_sg {
+
+Tournament::Tournament(std::shared_ptr<Game> game, std::vector<AgentFactory> lineup)
+    : game_(std::move(game)), lineup_(std::move(lineup)) {
+    if (lineup_.size() != static_cast<std::size_t>(game_->num_players())) {
+        throw std::invalid_argument("There must be one agent per player");
+    }
+    seed_ = random_seed();
+}
+
+void Tournament::set_n_threads(int n_threads) {
+    if (n_threads < 1) {
+        throw std::invalid_argument("Tournament needs at least one thread");
+    }
+    thread_pool_ = n_threads == 1 ? nullptr : std::make_unique<ThreadPool>(n_threads);
+}
+
+void Tournament::set_seed(std::uint64_t seed) {
+    seed_ = seed;
+}
+
+std::uint64_t Tournament::seed() const {
+    return seed_;
+}
+
+void Tournament::set_seat_rotation(bool seat_rotation) {
+    seat_rotation_ = seat_rotation;
+}
+
+void Tournament::set_record_writer(std::shared_ptr<GameRecordWriter> writer, bool with_observations) {
+    record_writer_ = std::move(writer);
+    record_observations_ = with_observations;
+}
+
+std::uint64_t Tournament::match_seed(int match_id) const {
+    return stream_seed(seed_, match_id);
+}
+
+std::vector<int> Tournament::seating(int match_id) const {
+    const int n_players = game_->num_players();
+    const int shift = seat_rotation_ ? match_id % n_players : 0;
+    std::vector<int> agent_ids(n_players);
+    for (PlayerId player_id = 0; player_id < n_players; ++player_id) {
+        agent_ids[player_id] = (player_id + shift) % n_players;
+    }
+    return agent_ids;
+}
+
+TournamentResults Tournament::run(int n_matches) const {
+    if (n_matches < 0) {
+        throw std::invalid_argument("The number of matches cannot be negative");
+    }
+    const int n_players = game_->num_players();
+    // Each match writes its own entries, the sums are made afterwards in the order of the matches
+    std::vector<std::vector<double>> match_returns(n_matches);
+    std::vector<int> match_steps(n_matches, 0);
+    auto play = [&](int match_id) {
+        match_returns[match_id] = play_match(match_id, &match_steps[match_id]);
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    if (thread_pool_ == nullptr) {
+        for (int match_id = 0; match_id < n_matches; ++match_id) {
+            play(match_id);
+        }
+    } else {
+        thread_pool_->parallel_for(n_matches, play);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    TournamentResults results;
+    results.n_matches = n_matches;
+    results.seconds = elapsed.count();
+    results.returns.assign(n_players, std::vector<double>(n_matches));
+    for (int match_id = 0; match_id < n_matches; ++match_id) {
+        const std::vector<int> agent_ids = seating(match_id);
+        for (PlayerId player_id = 0; player_id < n_players; ++player_id) {
+            results.returns[agent_ids[player_id]][match_id] = match_returns[match_id][player_id];
+        }
+        results.n_steps += match_steps[match_id];
+    }
+    for (const std::vector<double>& returns : results.returns) {
+        double sum = 0.0;
+        for (double value : returns) {
+            sum += value;
+        }
+        const double mean = n_matches == 0 ? 0.0 : sum / n_matches;
+        double squares = 0.0;
+        for (double value : returns) {
+            squares += (value - mean) * (value - mean);
+        }
+        const double standard_error = n_matches < 2 ? 0.0 : std::sqrt(squares / (n_matches - 1) / n_matches);
+        results.mean_returns.push_back(mean);
+        results.confidence_radii.push_back(1.96 * standard_error);
+    }
+    return results;
+}
+
+std::vector<double> Tournament::play_match(int match_id, int* n_steps) const {
+    const std::vector<int> agent_ids = seating(match_id);
+    std::vector<std::unique_ptr<Agent>> agents;
+    agents.reserve(agent_ids.size());
+    for (int agent_id : agent_ids) {
+        agents.push_back(lineup_[agent_id]());
+    }
+    Manager manager(game_, std::move(agents), match_seed(match_id));
+    if (record_writer_ != nullptr) {
+        manager.set_record_writer(record_writer_, record_observations_);
+    }
+    std::vector<double> returns = manager.play();
+    if (n_steps != nullptr) {
+        *n_steps = manager.num_steps();
+    }
+    return returns;
+}
+
+}  // namespace belief_sg
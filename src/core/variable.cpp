@@ -1,9 +1,13 @@
 #include "Belief-SG/core/variable.h"
 
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "Belief-SG/core/hash.h"
+
 namespace belief_sg {
 
 Variable::Variable(std::string name, VariableValue value) : name_(std::move(name)), value_(std::move(value)) {}
@@ -48,6 +52,26 @@ std::string Variable::to_string() const {
     }, value_) + ")";
 }
 
+std::uint64_t Variable::hash() const {
+    std::uint64_t hash = hash_combine(std::hash<std::string>{}(name_), value_.index());
+    std::visit([&hash](const auto& val) {
+        using T = std::decay_t<decltype(val)>;
+
+        if constexpr (std::is_same_v<T, std::vector<std::string>> ||
+                      std::is_same_v<T, std::vector<int>> ||
+                      std::is_same_v<T, std::vector<double>> ||
+                      std::is_same_v<T, std::vector<bool>>) {
+            using Element = typename T::value_type;
+            for (const auto& elem : val) {
+                hash = hash_combine(hash, std::hash<Element>{}(elem));
+            }
+        } else {
+            hash = hash_combine(hash, std::hash<T>{}(val));
+        }
+    }, value_);
+    return hash;
+}
+
 bool Variable::operator==(const Variable& other) const {
     return name_ == other.name_ && value_ == other.value_;
 }
@@ -226,6 +226,10 @@ std::vector<double> Agram::returns(const State& state) const {
     return scores;
 }
 
+double Agram::min_return() const {
+    return 0.0;
+}
+
 std::vector<PlayerId> Agram::all_players() const {
     std::vector<PlayerId> players(num_players_);
     std::iota(players.begin(), players.end(), 0);
@@ -90,7 +90,7 @@ std::vector<ProbAction> Cuckoo::legal_actions(const State& state, PlayerId playe
     if (player_id == kChancePlayerId) { // Dealing or removing cards
         bool dealing = state.variable("dealing").value<bool>();
         if (dealing) {
-            int remaining = state.get_pieces_at(Position(num_players_)).size();
+            int remaining = state.get_pieces_at(Position(num_players_), false).size();
             int player_to = (52 - remaining) % num_players_;
 
             std::vector<std::unique_ptr<Move>> moves;
@@ -120,7 +120,7 @@ std::vector<ProbAction> Cuckoo::legal_actions(const State& state, PlayerId playe
         } else if (exchange) {
             // Previous player wants to exchange
             // If King -> not exchange
-            if (state.get_piece_at(Position(player_id)).can_have(PieceAttribute("rank", 13))) {
+            if (state.get_piece_at(Position(player_id), false).can_have(PieceAttribute("rank", 13))) {
                 std::vector<std::unique_ptr<Move>> moves;
                 moves.push_back(std::make_unique<SetVariable>(Variable("exchange", false)));
                 moves.push_back(std::make_unique<AssignPieceValue>(Position(player_id), PieceValue({{"rank", 13}})));
@@ -129,7 +129,7 @@ std::vector<ProbAction> Cuckoo::legal_actions(const State& state, PlayerId playe
             }
 
             // If no King -> exchange
-            if (state.get_piece_at(Position(player_id)).can_not_have(PieceAttribute("rank", 13))) {
+            if (state.get_piece_at(Position(player_id), false).can_not_have(PieceAttribute("rank", 13))) {
                 int previous_player_id = (player_id + num_players_ - 1) % num_players_;
                 std::vector<std::unique_ptr<Move>> moves;
                 moves.push_back(std::make_unique<SetVariable>(Variable("exchange", false)));
@@ -161,7 +161,7 @@ std::vector<ProbAction> Cuckoo::legal_actions(const State& state, PlayerId playe
                 exchange_moves.push_back(std::make_unique<SetNextPlayer>((player_id + 1) % num_players_));
                 actions.push_back(ProbAction(Action(std::move(exchange_moves)), 1.0));
             } else {
-                if (state.get_pieces_at(Position(num_players_+1)).empty()) {  // Last player can exchange or pass
+                if (state.get_pieces_at(Position(num_players_+1), false).empty()) {  // Last player can exchange or pass
                     std::vector<std::unique_ptr<Move>> pass_moves;
                     pass_moves.push_back(std::make_unique<SetVariable>(Variable("exchange", false)));
                     pass_moves.push_back(std::make_unique<SetNextPlayer>((player_id + 1) % num_players_));  // Go back to first player
@@ -174,7 +174,7 @@ std::vector<ProbAction> Cuckoo::legal_actions(const State& state, PlayerId playe
                 } else {  // Last player exchange if no King
 
                     // If King don't change
-                    if (state.get_piece_at(Position(num_players_+1)).can_have(PieceAttribute("rank", 13))) {
+                    if (state.get_piece_at(Position(num_players_+1), false).can_have(PieceAttribute("rank", 13))) {
                         std::vector<std::unique_ptr<Move>> moves;
                         moves.push_back(std::make_unique<SetVariable>(Variable("exchange", false)));
                         moves.push_back(std::make_unique<SetVariable>(Variable("reveal", true)));
@@ -184,7 +184,7 @@ std::vector<ProbAction> Cuckoo::legal_actions(const State& state, PlayerId playe
                     }
 
                     // If no King -> exchange
-                    if (state.get_piece_at(Position(num_players_+1)).can_not_have(PieceAttribute("rank", 13))) {
+                    if (state.get_piece_at(Position(num_players_+1), false).can_not_have(PieceAttribute("rank", 13))) {
                         
                         std::vector<std::unique_ptr<Move>> moves;
                         moves.push_back(std::make_unique<SetVariable>(Variable("exchange", false)));
@@ -221,7 +221,7 @@ std::vector<double> Cuckoo::returns(const State& state) const {
     int min_rank = 14;
     int min_player_id = -1;
     for (int player_id = 0; player_id < num_players_; player_id++) {
-        int rank = state.get_piece_at(Position(player_id)).values.back().get_attribute("rank").value<int>();
+        int rank = state.get_piece_at(Position(player_id), false).values.back().get_attribute("rank").value<int>();
         if (rank < min_rank) {
             min_rank = rank;
             min_player_id = player_id;
@@ -233,6 +233,10 @@ std::vector<double> Cuckoo::returns(const State& state) const {
     return returns;
 }
 
+double Cuckoo::min_return() const {
+    return 0.0;
+}
+
 std::vector<PlayerId> Cuckoo::all_players() const {
     std::vector<PlayerId> players(num_players_);
     std::iota(players.begin(), players.end(), 0);
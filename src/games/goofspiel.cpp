@@ -18,16 +18,19 @@
 
 namespace belief_sg {
 
-Goofspiel::Goofspiel(int num_players) : num_players_(num_players) {
+Goofspiel::Goofspiel(int num_players, int num_cards) : num_players_(num_players), num_cards_(num_cards) {
     if (num_players_ < 2) {
         throw std::invalid_argument("Goofspiel must be played with at least 2 players");
     }
+    if (num_cards_ < 1) {
+        throw std::invalid_argument("Goofspiel must be played with at least 1 card");
+    }
 
     std::vector<std::vector<int>> adj(2*num_players_ + 2);
     play_graph_ = PlayGraph(adj);
 
     std::vector<PieceValue> card_values;
-    for (int i = 1; i <= 13; i++) {
+    for (int i = 1; i <= num_cards_; i++) {
         card_values.push_back(PieceValue({{"rank", i}}));
     }
 
@@ -54,12 +57,12 @@ State Goofspiel::initial_state(const PointOfView& point_of_view) const {
     state_builder.set_initial_players({kChancePlayerId});
 
     for (PlayerId player_id = 0; player_id < num_players_; player_id++) {
-        for (int rank = 1; rank <= 13; rank++) {
+        for (int rank = 1; rank <= num_cards_; rank++) {
             state_builder.add_piece(card_types_[player_id], PieceValue({{"rank", rank}}), {player_id}, Position(player_id));
         }
     }
 
-    for (int rank = 1; rank <= 13; rank++) {
+    for (int rank = 1; rank <= num_cards_; rank++) {
         state_builder.add_piece(card_types_[num_players_], PieceValue({{"rank", rank}}), {}, Position(2*num_players_));
     }
 
@@ -76,7 +79,7 @@ std::vector<ProbAction> Goofspiel::legal_actions(const State& state, PlayerId pl
 
     std::vector<ProbAction> actions;
     if (player_id == kChancePlayerId) {
-        if (state.get_pieces_at(Position(2*num_players_+1)).empty()) {  // First turn
+        if (state.get_pieces_at(Position(2*num_players_+1), false).empty()) {  // First turn
             std::vector<std::unique_ptr<Move>> moves;
             moves.push_back(std::make_unique<MovePiece>(Position(2*num_players_), Position(2*num_players_+1)));
             moves.push_back(std::make_unique<Reveal>(Position(2*num_players_+1, 0), all_players()));
@@ -87,7 +90,7 @@ std::vector<ProbAction> Goofspiel::legal_actions(const State& state, PlayerId pl
             int max_rank = -1;
             std::vector<PlayerId> max_players;
             for (int cell_id = num_players_; cell_id < 2*num_players_; cell_id++) {
-                const Piece& piece = state.get_piece_at(Position(cell_id));
+                const Piece& piece = state.get_piece_at(Position(cell_id), false);
                 if (piece.values[0].get_attribute("rank").value<int>() > max_rank) {
                     max_rank = piece.values[0].get_attribute("rank").value<int>();
                     max_players = { cell_id-num_players_ };
@@ -97,7 +100,7 @@ std::vector<ProbAction> Goofspiel::legal_actions(const State& state, PlayerId pl
                 moves.push_back(std::make_unique<RemovePiece>(Position(cell_id)));
             }
 
-            int piece_rank = state.get_piece_at(Position(2*num_players_+1)).values[0].get_attribute("rank").value<int>();
+            int piece_rank = state.get_piece_at(Position(2*num_players_+1), false).values[0].get_attribute("rank").value<int>();
 
             auto scores = state.variable("scores").value<std::vector<double>>();
             for (PlayerId max_player : max_players) {
@@ -105,7 +108,7 @@ std::vector<ProbAction> Goofspiel::legal_actions(const State& state, PlayerId pl
             }
             moves.push_back(std::make_unique<SetVariable>(Variable("scores", scores)));
             moves.push_back(std::make_unique<RemovePiece>(Position(2*num_players_+1)));
-            if (state.get_pieces_at(Position(2*num_players_)).empty()) {
+            if (state.get_pieces_at(Position(2*num_players_), false).empty()) {
                 moves.push_back(std::make_unique<SetNextPlayers>(std::vector<PlayerId>{}));
             } else {
                 moves.push_back(std::make_unique<MovePiece>(Position(2*num_players_), Position(2*num_players_+1)));
@@ -115,7 +118,7 @@ std::vector<ProbAction> Goofspiel::legal_actions(const State& state, PlayerId pl
             actions.push_back(ProbAction(Action(std::move(moves)), 1.0));
         }
     } else {
-        for (int stack_id = 0; stack_id < state.get_pieces_at(Position(player_id)).size(); stack_id++) {
+        for (int stack_id = 0; stack_id < state.get_pieces_at(Position(player_id), false).size(); stack_id++) {
             std::vector<std::unique_ptr<Move>> moves;
             moves.push_back(std::make_unique<MovePiece>(Position(player_id, stack_id), Position(num_players_+player_id)));
             moves.push_back(std::make_unique<Reveal>(Position(player_id+num_players_), all_players()));
@@ -138,6 +141,10 @@ std::vector<double> Goofspiel::returns(const State& state) const {
     return state.variable("scores").value<std::vector<double>>();
 }
 
+double Goofspiel::min_return() const {
+    return 0.0;
+}
+
 std::vector<PlayerId> Goofspiel::all_players() const {
     std::vector<PlayerId> players(num_players_);
     std::iota(players.begin(), players.end(), 0);
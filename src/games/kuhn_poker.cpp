@@ -167,6 +167,11 @@ std::vector<double> KuhnPoker::returns(const State& state) const {
     return {0.0, 0.0};
 }
 
+double KuhnPoker::min_return() const {
+    // The ante and the bet are lost
+    return -2.0;
+}
+
 bool KuhnPoker::wins(const PieceValue& value_first, const PieceValue& value_second) {
     if (value_first == PieceValue({{"rank", "K"}})) {
         return true;
@@ -27,29 +27,10 @@ namespace belief_sg {
 BattleStratego::BattleStratego(const Position& from) : from_(from) {}
 
 std::vector<ProbTransition> BattleStratego::apply(const State& state) const {
-    if (state.get_pieces_at(from_).size() < 2) {
+    if (state.get_pieces_at(from_, false).size() < 2) {
         return std::vector<ProbTransition>{ProbTransition({state, 1.0})};
     }
 
-    auto survives = [](const PieceValue& attacker, const PieceValue& defender) {
-        if (attacker == defender) {
-            return false;
-        }
-        if (attacker == PieceValue({{"rank", "Flag"}})) {
-            return false;
-        }
-        if (attacker == PieceValue({{"rank", "Bomb"}})) {
-            return defender != PieceValue({{"rank", "Miner"}});
-        }
-        if (attacker == PieceValue({{"rank", "Miner"}})) {
-            return defender != PieceValue({{"rank", "Soldier"}});
-        }
-        if (attacker == PieceValue({{"rank", "Soldier"}})) {
-            return defender != PieceValue({{"rank", "Bomb"}});
-        }
-        return false;
-    };
-
     std::vector<ProbTransition> transitions;
 
     std::vector<Piece> pieces = state.get_pieces_at(from_);
@@ -59,20 +40,7 @@ std::vector<ProbTransition> BattleStratego::apply(const State& state) const {
 
             double transition_prob = pieces[0].probability(value_1) * pieces[1].probability(value_2);
 
-            new_state.assign_piece_value(Position(from_.cell_id(), 0), value_1);
-            new_state.assign_piece_value(Position(from_.cell_id(), 1), value_2);
-
-            bool survives_1 = survives(value_1, value_2);
-            bool survives_2 = survives(value_2, value_1);
-
-            if (!survives_1 && !survives_2) {
-                new_state.remove_piece(Position(from_.cell_id(), 0));
-                new_state.remove_piece(Position(from_.cell_id(), 0));
-            } else if (!survives_1) {
-                new_state.remove_piece(Position(from_.cell_id(), 0));
-            } else if (!survives_2) {
-                new_state.remove_piece(Position(from_.cell_id(), 1));
-            }
+            fight(new_state, value_1, value_2);
 
             transitions.push_back(ProbTransition({new_state, transition_prob}));
         }
@@ -82,10 +50,47 @@ std::vector<ProbTransition> BattleStratego::apply(const State& state) const {
 }
 
 void BattleStratego::apply_inplace(State& state, std::mt19937& generator) const {
-    if (state.get_pieces_at(from_).size() < 2) {
+    if (state.get_pieces_at(from_, false).size() < 2) {
         return;
     }
 
+    std::vector<Piece> pieces = state.get_pieces_at(from_, false);
+
+    std::uniform_int_distribution<std::size_t> dist_0(0, pieces[0].values.size()-1);
+    PieceValue value_0 = pieces[0].values[dist_0(generator)];
+
+    std::uniform_int_distribution<std::size_t> dist_1(0, pieces[1].values.size()-1);
+    PieceValue value_1 = pieces[1].values[dist_1(generator)];
+
+    fight(state, value_0, value_1);
+}
+
+void BattleStratego::apply_inplace_observed(State& state, std::mt19937& generator, Observation& observation) const {
+    std::vector<Piece> pieces = state.get_pieces_at(from_, false);
+    if (pieces.size() < 2) {
+        observation.draws.emplace_back();
+        return;
+    }
+
+    std::uniform_int_distribution<std::size_t> dist_0(0, pieces[0].values.size()-1);
+    PieceValue value_0 = pieces[0].values[dist_0(generator)];
+
+    std::uniform_int_distribution<std::size_t> dist_1(0, pieces[1].values.size()-1);
+    PieceValue value_1 = pieces[1].values[dist_1(generator)];
+
+    fight(state, value_0, value_1);
+    observation.draws.push_back({value_0, value_1});
+}
+
+void BattleStratego::apply_observation(State& state, const Observation& observation, std::size_t& draw_id) const {
+    const std::vector<PieceValue>& values = observation.draws.at(draw_id++);
+    if (state.get_pieces_at(from_, false).size() < 2) {
+        return;
+    }
+    fight(state, values.at(0), values.at(1));
+}
+
+void BattleStratego::fight(State& state, const PieceValue& value_0, const PieceValue& value_1) const {
     auto survives = [](const PieceValue& attacker, const PieceValue& defender) {
         if (attacker == defender) {
             return false;
@@ -105,14 +110,7 @@ void BattleStratego::apply_inplace(State& state, std::mt19937& generator) const
         return false;
     };
 
-    std::vector<Piece> pieces = state.get_pieces_at(from_);
-
-    std::uniform_int_distribution<std::size_t> dist_0(0, pieces[0].values.size()-1);
-    PieceValue value_0 = pieces[0].values[dist_0(generator)];
     state.assign_piece_value(Position(from_.cell_id(), 0), value_0);
-
-    std::uniform_int_distribution<std::size_t> dist_1(0, pieces[1].values.size()-1);
-    PieceValue value_1 = pieces[1].values[dist_1(generator)];
     state.assign_piece_value(Position(from_.cell_id(), 1), value_1);
 
     bool survives_0 = survives(value_0, value_1);
@@ -216,14 +214,14 @@ std::vector<ProbAction> MiniStratego::legal_actions(const State& state, PlayerId
     }
 
     std::vector<ProbAction> actions;
-    if (!state.get_pieces_at(Position(25 + player_id)).empty()) {
+    if (!state.get_pieces_at(Position(25 + player_id), false).empty()) {
         for (const Position& neighbor_position : play_graph_.get_neighbor_positions(Position(25 + player_id))) {
-            if (!state.get_pieces_at(neighbor_position).empty()) {
+            if (!state.get_pieces_at(neighbor_position, false).empty()) {
                 continue;
             }
             std::vector<std::unique_ptr<Move>> moves;
             moves.push_back(std::make_unique<MovePiece>(Position(25 + player_id), neighbor_position));
-            if (state.get_pieces_at(Position(25 + player_id)).size() == 1) {
+            if (state.get_pieces_at(Position(25 + player_id), false).size() == 1) {
                 moves.push_back(std::make_unique<SetNextPlayer>(1 - player_id));
             }
             actions.push_back(
@@ -238,7 +236,7 @@ std::vector<ProbAction> MiniStratego::legal_actions(const State& state, PlayerId
 
     std::shared_ptr<const PieceType> current_type = player_id == 0 ? blue_stratego_type_ : red_stratego_type_;
     for (int i = 0; i < 25; i++) {
-        if (state.get_pieces_at(Position(i)).empty()) {
+        if (state.get_pieces_at(Position(i), false).empty()) {
             continue;
         }
         for (const Piece& piece : state.get_pieces_at(Position(i))) {
@@ -252,7 +250,7 @@ std::vector<ProbAction> MiniStratego::legal_actions(const State& state, PlayerId
             double action_prob = piece.probability(PieceValue({{"rank", "Miner"}})) + piece.probability(PieceValue({{"rank", "Soldier"}}));
 
             for (const Position& neighbor_position : play_graph_.get_neighbor_positions(Position(i))) {
-                if (state.get_pieces_at(neighbor_position).empty()) {
+                if (state.get_pieces_at(neighbor_position, false).empty()) {
                     std::vector<std::unique_ptr<Move>> moves;
                     moves.push_back(std::make_unique<RemovePieceValue>(Position(i), PieceValue({{"rank", "Flag"}})));
                     moves.push_back(std::make_unique<RemovePieceValue>(Position(i), PieceValue({{"rank", "Bomb"}})));
@@ -260,7 +258,7 @@ std::vector<ProbAction> MiniStratego::legal_actions(const State& state, PlayerId
                     moves.push_back(std::make_unique<SetVariable>(Variable("boring_moves", state.variable("boring_moves").value<int>()+1)));
                     moves.push_back(std::make_unique<SetNextPlayer>(1 - player_id));
                     actions.push_back(ProbAction({Action(std::move(moves)), action_prob}));
-                } else if (state.get_pieces_at(neighbor_position).size() == 1 && state.get_pieces_at(neighbor_position)[0].type != current_type) {
+                } else if (state.get_pieces_at(neighbor_position, false).size() == 1 && state.get_pieces_at(neighbor_position, false)[0].type != current_type) {
                     std::vector<std::unique_ptr<Move>> moves;
                     moves.push_back(std::make_unique<RemovePieceValue>(Position(i), PieceValue({{"rank", "Flag"}})));
                     moves.push_back(std::make_unique<RemovePieceValue>(Position(i), PieceValue({{"rank", "Bomb"}})));
@@ -286,7 +284,7 @@ bool MiniStratego::is_terminal(const State& state) const {
     bool red_flag = false;
     bool blue_flag = false;
     for (int i = 0; i < 27; i++) {
-        for (const Piece& piece : state.get_pieces_at(Position(i))) {
+        for (const Piece& piece : state.get_pieces_at(Position(i), false)) {
             if (piece.type == blue_stratego_type_ && piece.can_be(PieceValue({{"rank", "Flag"}}))) {
                 blue_flag = true;
             }
@@ -320,7 +318,7 @@ std::vector<double> MiniStratego::returns(const State& state) const {
     bool red_flag = false;
     bool blue_flag = false;
     for (int i = 0; i < 27; i++) {
-        for (const Piece& piece : state.get_pieces_at(Position(i))) {
+        for (const Piece& piece : state.get_pieces_at(Position(i), false)) {
             if (piece.type == blue_stratego_type_ && piece.can_be(PieceValue({{"rank", "Flag"}}))) {
                 blue_flag = true;
             }
@@ -342,4 +340,8 @@ std::vector<double> MiniStratego::returns(const State& state) const {
     return {0.0, 0.0};
 }
 
+double MiniStratego::min_return() const {
+    return -1.0;
+}
+
 }  // namespace belief_sg
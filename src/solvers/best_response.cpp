@@ -0,0 +1,203 @@
+#include "Belief-SG/solvers/best_response.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Belief-SG/core/action.h"
+#include "Belief-SG/core/agent.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/solvers/game_tree.h"
+
+namespace belief_sg {
+
+namespace {
+
+// Backward induction for one player over the tree
+class BestResponseSearch {
+public:
+    BestResponseSearch(const GameTree& tree, PlayerId player, const std::vector<double>& policy)
+        : tree_(tree), player_(player), policy_(policy),
+          reach_(tree.nodes().size(), 0.0),
+          values_(tree.nodes().size(), std::numeric_limits<double>::quiet_NaN()),
+          best_actions_(tree.information_sets().size(), -1) {
+        // The children of a node come after it, so one pass in order spreads the reach down
+        const std::vector<GameTree::Node>& nodes = tree_.nodes();
+        reach_[0] = 1.0;
+        for (int node_id = 0; node_id < static_cast<int>(nodes.size()); ++node_id) {
+            const GameTree::Node& node = nodes[node_id];
+            const int n_joint_actions = static_cast<int>(node.outcome_offsets.size()) - 1;
+            for (int joint_action_id = 0; joint_action_id < n_joint_actions; ++joint_action_id) {
+                const double probability = reach_[node_id] * others_probability(node, joint_action_id, nullptr);
+                for (int o = node.outcome_offsets[joint_action_id]; o < node.outcome_offsets[joint_action_id + 1]; ++o) {
+                    reach_[node.outcomes[o].node_id] = probability * node.outcomes[o].probability;
+                }
+            }
+        }
+    }
+
+    double value(int node_id) {
+        if (!std::isnan(values_[node_id])) {
+            return values_[node_id];
+        }
+        const GameTree::Node& node = tree_.nodes()[node_id];
+        if (node.players.empty()) {
+            values_[node_id] = node.returns[player_];
+            return values_[node_id];
+        }
+        auto it = std::ranges::find(node.players, player_);
+        if (it == node.players.end()) {
+            values_[node_id] = action_values(node, -1)[0];
+            return values_[node_id];
+        }
+        // The values of all the nodes of the set are known once its action is chosen
+        best_action(node.information_sets[std::distance(node.players.begin(), it)]);
+        return values_[node_id];
+    }
+private:
+    // Probability of the actions of chance and of the other players in the joint action, and the
+    // action of the player, if it acts, in `action_id`
+    double others_probability(const GameTree::Node& node, int joint_action_id, int* action_id) const {
+        double probability = 1.0;
+        for (int i = static_cast<int>(node.players.size()) - 1, rest = joint_action_id; i >= 0; --i) {
+            if (node.players[i] == player_) {
+                if (action_id != nullptr) {
+                    *action_id = rest % node.n_actions[i];
+                }
+            } else {
+                probability *= tree_.action_probability(node, i, rest % node.n_actions[i], policy_);
+            }
+            rest /= node.n_actions[i];
+        }
+        return probability;
+    }
+
+    // Value of each action of the player at `player_index`, or of the node in a single entry if
+    // `player_index` is -1
+    std::vector<double> action_values(const GameTree::Node& node, int player_index) {
+        std::vector<double> values(player_index < 0 ? 1 : node.n_actions[player_index], 0.0);
+        const int n_joint_actions = static_cast<int>(node.outcome_offsets.size()) - 1;
+        for (int joint_action_id = 0; joint_action_id < n_joint_actions; ++joint_action_id) {
+            int action_id = 0;
+            const double probability = others_probability(node, joint_action_id, &action_id);
+            if (probability == 0.0) {
+                continue;
+            }
+            double joint_value = 0.0;
+            for (int o = node.outcome_offsets[joint_action_id]; o < node.outcome_offsets[joint_action_id + 1]; ++o) {
+                joint_value += node.outcomes[o].probability * value(node.outcomes[o].node_id);
+            }
+            values[player_index < 0 ? 0 : action_id] += probability * joint_value;
+        }
+        return values;
+    }
+
+    void best_action(int information_set_id) {
+        if (best_actions_[information_set_id] == kInProgress) {
+            throw std::logic_error("An information set follows itself, the game does not have perfect recall");
+        }
+        best_actions_[information_set_id] = kInProgress;
+        const GameTree::InformationSet& information_set = tree_.information_sets()[information_set_id];
+        std::vector<std::vector<double>> member_values;
+        member_values.reserve(information_set.members.size());
+        std::vector<double> totals(information_set.actions.size(), 0.0);
+        for (const GameTree::Member& member : information_set.members) {
+            member_values.push_back(action_values(tree_.nodes()[member.node_id], member.player_index));
+            for (std::size_t a = 0; a < totals.size(); ++a) {
+                totals[a] += reach_[member.node_id] * member_values.back()[a];
+            }
+        }
+        const int action_id = static_cast<int>(std::distance(totals.begin(), std::ranges::max_element(totals)));
+        best_actions_[information_set_id] = action_id;
+        for (std::size_t m = 0; m < information_set.members.size(); ++m) {
+            values_[information_set.members[m].node_id] = member_values[m][action_id];
+        }
+    }
+
+    static constexpr int kInProgress = -2;
+
+    const GameTree& tree_;
+    PlayerId player_;
+    const std::vector<double>& policy_;
+    // Probability that chance and the other players reach each node
+    std::vector<double> reach_;
+    // Value of each node for the player, NaN until computed
+    std::vector<double> values_;
+    // Action of each information set of the player, -1 until chosen
+    std::vector<int> best_actions_;
+};
+
+}  // namespace
+
+BestResponse::BestResponse(std::shared_ptr<const GameTree> tree) : tree_(std::move(tree)) {}
+
+void BestResponse::set_n_threads(int n_threads) {
+    if (n_threads < 1) {
+        throw std::invalid_argument("BestResponse needs at least one thread");
+    }
+    thread_pool_ = n_threads == 1 ? nullptr : std::make_unique<ThreadPool>(n_threads);
+}
+
+std::vector<double> BestResponse::agent_policy(const std::vector<std::unique_ptr<Agent>>& agents) const {
+    if (agents.size() != static_cast<std::size_t>(tree_->num_players())) {
+        throw std::invalid_argument("There must be one agent per player");
+    }
+    for (PlayerId player_id = 0; player_id < static_cast<PlayerId>(agents.size()); ++player_id) {
+        agents[player_id]->set_game(tree_->game());
+        agents[player_id]->set_player(player_id);
+    }
+    // Agents are not thread safe, they are asked one after the other
+    std::vector<double> policy(tree_->n_actions(), 0.0);
+    for (const GameTree::InformationSet& information_set : tree_->information_sets()) {
+        const Action action = agents[information_set.player]->act(information_set.private_state, information_set.public_state);
+        auto it = std::ranges::find(information_set.actions, action);
+        if (it == information_set.actions.end()) {
+            throw std::runtime_error("The agent chose an illegal action");
+        }
+        policy[information_set.offset + std::distance(information_set.actions.begin(), it)] = 1.0;
+    }
+    return policy;
+}
+
+std::vector<double> BestResponse::best_response_values(const std::vector<double>& policy) const {
+    if (policy.size() != tree_->n_actions()) {
+        throw std::invalid_argument("The policy does not match the information sets of the tree");
+    }
+    std::vector<double> values(tree_->num_players());
+    auto compute = [&](int player_id) {
+        values[player_id] = best_response_value(player_id, policy);
+    };
+    if (thread_pool_ == nullptr) {
+        for (PlayerId player_id = 0; player_id < static_cast<PlayerId>(values.size()); ++player_id) {
+            compute(player_id);
+        }
+    } else {
+        thread_pool_->parallel_for(static_cast<int>(values.size()), compute);
+    }
+    return values;
+}
+
+double BestResponse::nash_conv(const std::vector<double>& policy) const {
+    const std::vector<double> best_values = best_response_values(policy);
+    const std::vector<double> values = tree_->expected_returns(policy);
+    double total = 0.0;
+    for (std::size_t p = 0; p < values.size(); ++p) {
+        total += best_values[p] - values[p];
+    }
+    return total;
+}
+
+double BestResponse::exploitability(const std::vector<double>& policy) const {
+    return nash_conv(policy) / tree_->num_players();
+}
+
+double BestResponse::best_response_value(PlayerId player, const std::vector<double>& policy) const {
+    return BestResponseSearch(*tree_, player, policy).value(0);
+}
+
+}  // namespace belief_sg
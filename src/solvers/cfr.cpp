@@ -0,0 +1,378 @@
+#include "Belief-SG/solvers/cfr.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/seeding.h"
+#include "Belief-SG/core/state.h"
+#include "Belief-SG/solvers/game_tree.h"
+
+namespace belief_sg {
+
+CFRSolver::CFRSolver(std::shared_ptr<Game> game, CFRVariant variant)
+    : variant_(variant), n_players_(game->num_players()), seed_(random_seed()) {
+    auto start_time = std::chrono::steady_clock::now();
+    tree_ = std::make_shared<const GameTree>(std::move(game));
+    regrets_.assign(tree_->n_actions(), 0.0);
+    strategy_sums_.assign(tree_->n_actions(), 0.0);
+    strategy_.assign(tree_->n_actions(), 0.0);
+    update_strategy();
+    stats_.build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void CFRSolver::set_n_threads(int n_threads) {
+    if (n_threads < 1) {
+        throw std::invalid_argument("CFRSolver needs at least one thread");
+    }
+    thread_pool_ = n_threads == 1 ? nullptr : std::make_unique<ThreadPool>(n_threads);
+    split_depth_ = -1;
+    if (thread_pool_ == nullptr) {
+        return;
+    }
+    // A few subtrees per thread, so that uneven subtrees still keep every thread busy
+    const std::vector<int>& depth_counts = tree_->depth_counts();
+    for (int depth = 0; depth < static_cast<int>(depth_counts.size()); ++depth) {
+        if (depth_counts[depth] >= 4 * n_threads) {
+            split_depth_ = depth;
+            break;
+        }
+    }
+}
+
+void CFRSolver::set_seed(std::uint64_t seed) {
+    seed_ = seed;
+}
+
+void CFRSolver::run(int n_iterations) {
+    auto start_time = std::chrono::steady_clock::now();
+    if (variant_ == CFRVariant::ExternalSampling) {
+        run_sampled_iterations(n_iterations);
+    } else {
+        for (int iteration = 0; iteration < n_iterations; ++iteration) {
+            run_full_iteration();
+        }
+    }
+    stats_.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+std::vector<double> CFRSolver::average_strategy(const State& private_state) const {
+    const int information_set_id = tree_->find_information_set(private_state);
+    if (information_set_id < 0) {
+        throw std::invalid_argument("The state is not an information set of the game");
+    }
+    const GameTree::InformationSet& information_set = tree_->information_sets()[information_set_id];
+    const std::vector<double> policy = average_policy();
+    return {policy.begin() + information_set.offset, policy.begin() + information_set.offset + information_set.actions.size()};
+}
+
+std::vector<double> CFRSolver::average_policy() const {
+    std::vector<double> policy(strategy_sums_.size());
+    for (const GameTree::InformationSet& information_set : tree_->information_sets()) {
+        const auto n_actions = static_cast<int>(information_set.actions.size());
+        double total = 0.0;
+        for (int a = 0; a < n_actions; ++a) {
+            total += strategy_sums_[information_set.offset + a];
+        }
+        for (int a = 0; a < n_actions; ++a) {
+            policy[information_set.offset + a] = total > 0.0
+                ? strategy_sums_[information_set.offset + a] / total
+                : 1.0 / n_actions;
+        }
+    }
+    return policy;
+}
+
+std::vector<double> CFRSolver::average_returns() const {
+    return tree_->expected_returns(average_policy());
+}
+
+const std::shared_ptr<const GameTree>& CFRSolver::tree() const {
+    return tree_;
+}
+
+std::size_t CFRSolver::n_nodes() const {
+    return tree_->nodes().size();
+}
+
+std::size_t CFRSolver::n_information_sets() const {
+    return tree_->information_sets().size();
+}
+
+const CFRStats& CFRSolver::stats() const {
+    return stats_;
+}
+
+void CFRSolver::run_full_iteration() {
+    Deltas deltas{std::vector<double>(regrets_.size(), 0.0), std::vector<double>(regrets_.size(), 0.0)};
+    const std::vector<double> root_reach(n_players_ + 1, 1.0);
+    std::size_t frontier_index = 0;
+    if (split_depth_ < 0) {
+        traverse(0, root_reach, deltas, nullptr, frontier_index);
+    } else {
+        std::vector<FrontierNode> frontier;
+        collect_frontier(0, root_reach, frontier);
+        // Contiguous chunks of the frontier, each with its own deltas, summed in chunk order
+        const int n_chunks = std::min(static_cast<int>(frontier.size()), 4 * thread_pool_->size());
+        std::vector<Deltas> chunk_deltas(n_chunks, deltas);
+        std::vector<std::vector<double>> frontier_values(frontier.size());
+        thread_pool_->parallel_for(n_chunks, [&](int chunk_id) {
+            const std::size_t begin = frontier.size() * chunk_id / n_chunks;
+            const std::size_t end = frontier.size() * (chunk_id + 1) / n_chunks;
+            for (std::size_t i = begin; i < end; ++i) {
+                std::size_t unused_index = 0;
+                frontier_values[i] = traverse(frontier[i].node_id, frontier[i].reach, chunk_deltas[chunk_id], nullptr, unused_index);
+            }
+        });
+        traverse(0, root_reach, deltas, &frontier_values, frontier_index);
+        for (const Deltas& chunk : chunk_deltas) {
+            for (std::size_t i = 0; i < regrets_.size(); ++i) {
+                deltas.regrets[i] += chunk.regrets[i];
+                deltas.strategy_sums[i] += chunk.strategy_sums[i];
+            }
+        }
+    }
+    apply(deltas);
+}
+
+void CFRSolver::run_sampled_iterations(int n_iterations) {
+    const int batch_size = thread_pool_ == nullptr ? 1 : thread_pool_->size();
+    Deltas empty{std::vector<double>(regrets_.size(), 0.0), std::vector<double>(regrets_.size(), 0.0)};
+    for (int done = 0; done < n_iterations; done += batch_size) {
+        const int n_batch = std::min(batch_size, n_iterations - done);
+        // Each iteration samples one traversal per player with the generator of its stream
+        const std::uint64_t first_stream = n_sampled_iterations_;
+        n_sampled_iterations_ += n_batch;
+        std::vector<Deltas> batch_deltas(n_batch, empty);
+        auto run_iteration = [&](int i) {
+            std::mt19937 generator = make_generator(stream_seed(seed_, first_stream + i));
+            for (PlayerId traverser = 0; traverser < n_players_; ++traverser) {
+                sample(0, traverser, batch_deltas[i], generator);
+            }
+        };
+        if (thread_pool_ == nullptr) {
+            run_iteration(0);
+        } else {
+            thread_pool_->parallel_for(n_batch, run_iteration);
+        }
+        Deltas deltas = empty;
+        for (const Deltas& iteration_deltas : batch_deltas) {
+            for (std::size_t i = 0; i < regrets_.size(); ++i) {
+                deltas.regrets[i] += iteration_deltas.regrets[i];
+                deltas.strategy_sums[i] += iteration_deltas.strategy_sums[i];
+            }
+        }
+        // The iterations of a batch count one by one
+        stats_.n_iterations += n_batch - 1;
+        apply(deltas);
+    }
+}
+
+void CFRSolver::apply(const Deltas& deltas) {
+    stats_.n_iterations++;
+    const double weight = variant_ == CFRVariant::Plus ? stats_.n_iterations : 1.0;
+    for (std::size_t i = 0; i < regrets_.size(); ++i) {
+        regrets_[i] += deltas.regrets[i];
+        if (variant_ == CFRVariant::Plus) {
+            regrets_[i] = std::max(regrets_[i], 0.0);
+        }
+        strategy_sums_[i] += weight * deltas.strategy_sums[i];
+    }
+    update_strategy();
+}
+
+void CFRSolver::update_strategy() {
+    for (const GameTree::InformationSet& information_set : tree_->information_sets()) {
+        const auto n_actions = static_cast<int>(information_set.actions.size());
+        double total = 0.0;
+        for (int a = 0; a < n_actions; ++a) {
+            total += std::max(regrets_[information_set.offset + a], 0.0);
+        }
+        for (int a = 0; a < n_actions; ++a) {
+            strategy_[information_set.offset + a] = total > 0.0
+                ? std::max(regrets_[information_set.offset + a], 0.0) / total
+                : 1.0 / n_actions;
+        }
+    }
+}
+
+int CFRSolver::reach_index(PlayerId player) const {
+    return player == kChancePlayerId ? n_players_ : player;
+}
+
+void CFRSolver::collect_frontier(int node_id, const std::vector<double>& reach, std::vector<FrontierNode>& frontier) const {
+    const GameTree::Node& node = tree_->nodes()[node_id];
+    if (node.players.empty()) {
+        return;
+    }
+    if (node.depth == split_depth_) {
+        frontier.push_back({.node_id = node_id, .reach = reach});
+        return;
+    }
+    const int n_joint_actions = static_cast<int>(node.outcome_offsets.size()) - 1;
+    std::vector<double> child_reach(reach.size());
+    for (int joint_action_id = 0; joint_action_id < n_joint_actions; ++joint_action_id) {
+        std::vector<double> joint_reach(reach);
+        for (int i = static_cast<int>(node.players.size()) - 1, rest = joint_action_id; i >= 0; --i) {
+            joint_reach[reach_index(node.players[i])] *= tree_->action_probability(node, i, rest % node.n_actions[i], strategy_);
+            rest /= node.n_actions[i];
+        }
+        for (int o = node.outcome_offsets[joint_action_id]; o < node.outcome_offsets[joint_action_id + 1]; ++o) {
+            child_reach = joint_reach;
+            child_reach[n_players_] *= node.outcomes[o].probability;
+            collect_frontier(node.outcomes[o].node_id, child_reach, frontier);
+        }
+    }
+}
+
+std::vector<double> CFRSolver::traverse(int node_id, const std::vector<double>& reach, Deltas& deltas, const std::vector<std::vector<double>>* frontier_values, std::size_t& frontier_index) const {
+    const GameTree::Node& node = tree_->nodes()[node_id];
+    if (node.players.empty()) {
+        return node.returns;
+    }
+    if (frontier_values != nullptr && node.depth == split_depth_) {
+        return (*frontier_values)[frontier_index++];
+    }
+
+    const int n_current = static_cast<int>(node.players.size());
+    const int n_joint_actions = static_cast<int>(node.outcome_offsets.size()) - 1;
+    std::vector<double> value(n_players_, 0.0);
+    // Counterfactual value of each action of each current player, against the others
+    std::vector<std::vector<double>> action_values(n_current);
+    for (int i = 0; i < n_current; ++i) {
+        action_values[i].assign(node.n_actions[i], 0.0);
+    }
+    std::vector<int> action_ids(n_current);
+    std::vector<double> probabilities(n_current);
+    std::vector<double> child_reach(reach.size());
+    for (int joint_action_id = 0; joint_action_id < n_joint_actions; ++joint_action_id) {
+        std::vector<double> joint_reach(reach);
+        double joint_probability = 1.0;
+        for (int i = n_current - 1, rest = joint_action_id; i >= 0; --i) {
+            action_ids[i] = rest % node.n_actions[i];
+            rest /= node.n_actions[i];
+            probabilities[i] = tree_->action_probability(node, i, action_ids[i], strategy_);
+            joint_probability *= probabilities[i];
+            joint_reach[reach_index(node.players[i])] *= probabilities[i];
+        }
+
+        std::vector<double> joint_value(n_players_, 0.0);
+        for (int o = node.outcome_offsets[joint_action_id]; o < node.outcome_offsets[joint_action_id + 1]; ++o) {
+            child_reach = joint_reach;
+            child_reach[n_players_] *= node.outcomes[o].probability;
+            std::vector<double> child_value = traverse(node.outcomes[o].node_id, child_reach, deltas, frontier_values, frontier_index);
+            for (int p = 0; p < n_players_; ++p) {
+                joint_value[p] += node.outcomes[o].probability * child_value[p];
+            }
+        }
+
+        for (int p = 0; p < n_players_; ++p) {
+            value[p] += joint_probability * joint_value[p];
+        }
+        for (int i = 0; i < n_current; ++i) {
+            if (node.players[i] == kChancePlayerId) {
+                continue;
+            }
+            double others_probability = 1.0;
+            for (int j = 0; j < n_current; ++j) {
+                if (j != i) {
+                    others_probability *= probabilities[j];
+                }
+            }
+            action_values[i][action_ids[i]] += others_probability * joint_value[node.players[i]];
+        }
+    }
+
+    for (int i = 0; i < n_current; ++i) {
+        if (node.players[i] == kChancePlayerId) {
+            continue;
+        }
+        const PlayerId player = node.players[i];
+        double counterfactual_reach = 1.0;
+        for (int r = 0; r <= n_players_; ++r) {
+            if (r != player) {
+                counterfactual_reach *= reach[r];
+            }
+        }
+        const int offset = tree_->information_sets()[node.information_sets[i]].offset;
+        for (int a = 0; a < node.n_actions[i]; ++a) {
+            deltas.regrets[offset + a] += counterfactual_reach * (action_values[i][a] - value[player]);
+            deltas.strategy_sums[offset + a] += reach[player] * strategy_[offset + a];
+        }
+    }
+    return value;
+}
+
+double CFRSolver::sample(int node_id, PlayerId traverser, Deltas& deltas, std::mt19937& generator) const {
+    const GameTree::Node& node = tree_->nodes()[node_id];
+    if (node.players.empty()) {
+        return node.returns[traverser];
+    }
+
+    // The other players and chance play one sampled action, whose strategy is averaged
+    const int n_current = static_cast<int>(node.players.size());
+    int traverser_index = -1;
+    std::vector<int> action_ids(n_current);
+    for (int i = 0; i < n_current; ++i) {
+        if (node.players[i] == traverser) {
+            traverser_index = i;
+            continue;
+        }
+        std::vector<double> probabilities(node.n_actions[i]);
+        for (int a = 0; a < node.n_actions[i]; ++a) {
+            probabilities[a] = tree_->action_probability(node, i, a, strategy_);
+        }
+        std::discrete_distribution<int> distribution(probabilities.begin(), probabilities.end());
+        action_ids[i] = distribution(generator);
+        if (node.information_sets[i] >= 0) {
+            const int offset = tree_->information_sets()[node.information_sets[i]].offset;
+            for (int a = 0; a < node.n_actions[i]; ++a) {
+                deltas.strategy_sums[offset + a] += probabilities[a];
+            }
+        }
+    }
+
+    auto sample_outcome = [&]() {
+        int joint_action_id = 0;
+        for (int i = 0; i < n_current; ++i) {
+            joint_action_id = joint_action_id * node.n_actions[i] + action_ids[i];
+        }
+        const int begin = node.outcome_offsets[joint_action_id];
+        const int end = node.outcome_offsets[joint_action_id + 1];
+        std::vector<double> probabilities;
+        probabilities.reserve(end - begin);
+        for (int o = begin; o < end; ++o) {
+            probabilities.push_back(node.outcomes[o].probability);
+        }
+        std::discrete_distribution<int> distribution(probabilities.begin(), probabilities.end());
+        return sample(node.outcomes[begin + distribution(generator)].node_id, traverser, deltas, generator);
+    };
+
+    if (traverser_index < 0) {
+        return sample_outcome();
+    }
+    // Every action of the traverser is explored
+    const int offset = tree_->information_sets()[node.information_sets[traverser_index]].offset;
+    const int n_actions = node.n_actions[traverser_index];
+    std::vector<double> action_values(n_actions);
+    double value = 0.0;
+    for (int a = 0; a < n_actions; ++a) {
+        action_ids[traverser_index] = a;
+        action_values[a] = sample_outcome();
+        value += strategy_[offset + a] * action_values[a];
+    }
+    for (int a = 0; a < n_actions; ++a) {
+        deltas.regrets[offset + a] += action_values[a] - value;
+    }
+    return value;
+}
+
+}  // namespace belief_sg
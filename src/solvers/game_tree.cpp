@@ -0,0 +1,215 @@
+#include "Belief-SG/solvers/game_tree.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Belief-SG/core/action.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/point_of_view.h"
+#include "Belief-SG/core/prob_transition.h"
+#include "Belief-SG/core/state.h"
+
+namespace belief_sg {
+
+GameTree::GameTree(std::shared_ptr<Game> game) : game_(std::move(game)), n_players_(game_->num_players()) {
+    std::vector<State> private_states;
+    private_states.reserve(n_players_);
+    for (PlayerId player_id = 0; player_id < n_players_; ++player_id) {
+        private_states.push_back(game_->initial_state(PointOfView(PointOfView::Type::Private, player_id)));
+    }
+    build(game_->initial_state(PointOfView(PointOfView::Type::World)), private_states,
+          game_->initial_state(PointOfView(PointOfView::Type::Public)), 0);
+}
+
+const std::shared_ptr<Game>& GameTree::game() const {
+    return game_;
+}
+
+int GameTree::num_players() const {
+    return n_players_;
+}
+
+const std::vector<GameTree::Node>& GameTree::nodes() const {
+    return nodes_;
+}
+
+const std::vector<GameTree::InformationSet>& GameTree::information_sets() const {
+    return information_sets_;
+}
+
+const std::vector<int>& GameTree::depth_counts() const {
+    return depth_counts_;
+}
+
+std::size_t GameTree::n_actions() const {
+    return n_actions_;
+}
+
+int GameTree::find_information_set(const State& private_state) const {
+    auto it = information_set_ids_.find(private_state.hash());
+    return it == information_set_ids_.end() ? -1 : it->second;
+}
+
+double GameTree::action_probability(const Node& node, int player_index, int action_id, const std::vector<double>& policy) const {
+    const int information_set = node.information_sets[player_index];
+    if (information_set < 0) {
+        return 1.0 / node.n_actions[player_index];
+    }
+    return policy[information_sets_[information_set].offset + action_id];
+}
+
+std::vector<double> GameTree::uniform_policy() const {
+    std::vector<double> policy(n_actions_);
+    for (const InformationSet& information_set : information_sets_) {
+        const auto n_actions = static_cast<int>(information_set.actions.size());
+        std::fill_n(policy.begin() + information_set.offset, n_actions, 1.0 / n_actions);
+    }
+    return policy;
+}
+
+std::vector<double> GameTree::expected_returns(const std::vector<double>& policy) const {
+    if (policy.size() != n_actions_) {
+        throw std::invalid_argument("The policy does not match the information sets of the tree");
+    }
+    return evaluate(0, policy);
+}
+
+int GameTree::build(const State& world_state, const std::vector<State>& private_states, const State& public_state, int depth) {
+    const int node_id = static_cast<int>(nodes_.size());
+    nodes_.emplace_back();
+    nodes_[node_id].depth = depth;
+    if (depth_counts_.size() <= static_cast<std::size_t>(depth)) {
+        depth_counts_.resize(depth + 1, 0);
+    }
+    depth_counts_[depth]++;
+    if (game_->is_terminal(world_state)) {
+        nodes_[node_id].returns = game_->returns(world_state);
+        return node_id;
+    }
+
+    const std::vector<PlayerId> players = world_state.current_players();
+    std::vector<int> information_sets;
+    std::vector<std::vector<ProbAction>> legal_actions;
+    for (int i = 0; i < static_cast<int>(players.size()); ++i) {
+        // The players choose among the actions they see, chance among those of the world
+        if (players[i] == kChancePlayerId) {
+            legal_actions.push_back(game_->legal_actions(world_state, players[i]));
+            information_sets.push_back(-1);
+            continue;
+        }
+        legal_actions.push_back(game_->legal_actions(private_states[players[i]], players[i]));
+        std::vector<Action> actions;
+        actions.reserve(legal_actions.back().size());
+        for (const ProbAction& prob_action : legal_actions.back()) {
+            actions.push_back(prob_action.action);
+        }
+        const int information_set = information_set_id(players[i], private_states[players[i]], public_state, std::move(actions));
+        information_sets_[information_set].members.push_back({.node_id = node_id, .player_index = i});
+        information_sets.push_back(information_set);
+    }
+
+    std::vector<int> n_actions;
+    int n_joint_actions = 1;
+    for (const auto& actions : legal_actions) {
+        n_actions.push_back(static_cast<int>(actions.size()));
+        n_joint_actions *= static_cast<int>(actions.size());
+    }
+    std::vector<int> outcome_offsets = {0};
+    std::vector<Outcome> outcomes;
+    for (int joint_action_id = 0; joint_action_id < n_joint_actions; ++joint_action_id) {
+        std::vector<Action> joint_action(players.size());
+        for (int i = static_cast<int>(players.size()) - 1, rest = joint_action_id; i >= 0; --i) {
+            joint_action[i] = legal_actions[i][rest % n_actions[i]].action;
+            rest /= n_actions[i];
+        }
+        // Outcomes reaching the same world state are one node, whatever their number of paths
+        std::vector<ProbTransition> transitions = game_->apply_joint_action(world_state, joint_action);
+        merge_duplicate_transitions(transitions);
+        for (const ProbTransition& transition : transitions) {
+            if (transition.probability == 0.0) {
+                continue;
+            }
+            // Each point of view observes the outcome as the manager tells it
+            std::vector<State> next_private_states;
+            next_private_states.reserve(n_players_);
+            for (PlayerId player_id = 0; player_id < n_players_; ++player_id) {
+                next_private_states.push_back(observe(private_states[player_id], joint_action, transition.state));
+            }
+            const State next_public_state = observe(public_state, joint_action, transition.state);
+            const int child_id = build(transition.state, next_private_states, next_public_state, depth + 1);
+            outcomes.push_back({.probability = transition.probability, .node_id = child_id});
+        }
+        outcome_offsets.push_back(static_cast<int>(outcomes.size()));
+    }
+
+    Node& node = nodes_[node_id];
+    node.players = players;
+    node.information_sets = std::move(information_sets);
+    node.n_actions = std::move(n_actions);
+    node.outcome_offsets = std::move(outcome_offsets);
+    node.outcomes = std::move(outcomes);
+    return node_id;
+}
+
+int GameTree::information_set_id(PlayerId player_id, const State& private_state, const State& public_state, std::vector<Action> actions) {
+    auto [it, inserted] = information_set_ids_.try_emplace(private_state.hash(), static_cast<int>(information_sets_.size()));
+    if (!inserted) {
+        if (information_sets_[it->second].actions != actions) {
+            throw std::logic_error("The states of an information set have different legal actions");
+        }
+        return it->second;
+    }
+    const auto n_actions = actions.size();
+    information_sets_.push_back({
+        .player = player_id,
+        .offset = static_cast<int>(n_actions_),
+        .actions = std::move(actions),
+        .private_state = private_state,
+        .public_state = public_state,
+        .members = {}
+    });
+    n_actions_ += n_actions;
+    return it->second;
+}
+
+State GameTree::observe(const State& state, const std::vector<Action>& joint_action, const State& world_state) const {
+    std::optional<State> next_state = game_->consistent_transition(state, joint_action, world_state);
+    if (!next_state.has_value()) {
+        throw std::runtime_error("No state is consistent with the world state");
+    }
+    return std::move(*next_state);
+}
+
+std::vector<double> GameTree::evaluate(int node_id, const std::vector<double>& policy) const {
+    const Node& node = nodes_[node_id];
+    if (node.players.empty()) {
+        return node.returns;
+    }
+    const int n_joint_actions = static_cast<int>(node.outcome_offsets.size()) - 1;
+    std::vector<double> value(n_players_, 0.0);
+    for (int joint_action_id = 0; joint_action_id < n_joint_actions; ++joint_action_id) {
+        double joint_probability = 1.0;
+        for (int i = static_cast<int>(node.players.size()) - 1, rest = joint_action_id; i >= 0; --i) {
+            joint_probability *= action_probability(node, i, rest % node.n_actions[i], policy);
+            rest /= node.n_actions[i];
+        }
+        if (joint_probability == 0.0) {
+            continue;
+        }
+        for (int o = node.outcome_offsets[joint_action_id]; o < node.outcome_offsets[joint_action_id + 1]; ++o) {
+            std::vector<double> child_value = evaluate(node.outcomes[o].node_id, policy);
+            for (int p = 0; p < n_players_; ++p) {
+                value[p] += joint_probability * node.outcomes[o].probability * child_value[p];
+            }
+        }
+    }
+    return value;
+}
+
+}  // namespace belief_sg
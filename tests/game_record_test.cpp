@@ -0,0 +1,117 @@
+// Writes the records of random matches, reads them back and plays them again. The joint actions
+// found from each record must be those of its match, a writer reopening a file cut in the middle
+// of a record must append after the last complete one, and a file that is not a record file must
+// be refused. Exits with a non-zero status on failure.
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Belief-SG/agents/random_agent.h"
+#include "Belief-SG/core/action.h"
+#include "Belief-SG/core/agent.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/game_record.h"
+#include "Belief-SG/core/manager.h"
+#include "Belief-SG/games/kuhn_poker.h"
+#include "Belief-SG/games/mini_stratego.h"
+
+namespace {
+
+using namespace belief_sg;
+
+using History = std::vector<std::vector<Action>>;
+
+int n_failures = 0;
+
+void fail(const std::string& message) {
+    if (n_failures++ < 20) {
+        std::cerr << message << std::endl;
+    }
+}
+
+// Plays a match between random agents, appending its record to `writer`
+History play(const std::shared_ptr<Game>& game, std::uint64_t seed, const std::shared_ptr<GameRecordWriter>& writer, bool with_observations) {
+    std::vector<std::unique_ptr<Agent>> agents;
+    for (int player_id = 0; player_id < game->num_players(); ++player_id) {
+        agents.push_back(std::make_unique<RandomAgent>());
+    }
+    Manager manager(game, std::move(agents), seed);
+    manager.set_record_writer(writer, with_observations);
+    manager.play();
+    return manager.history();
+}
+
+void check_records(const std::string& path, const std::vector<std::pair<std::shared_ptr<Game>, History>>& matches, const std::string& where) {
+    const GameRecordReader reader(path);
+    if (reader.size() != matches.size()) {
+        fail(where + ": " + std::to_string(reader.size()) + " records instead of " + std::to_string(matches.size()));
+        return;
+    }
+    for (std::size_t record_id = 0; record_id < matches.size(); ++record_id) {
+        const auto& [game, history] = matches[record_id];
+        try {
+            if (record_joint_actions(*game, reader.record(record_id)) != history) {
+                fail(where + ": record " + std::to_string(record_id) + " does not play its match again");
+            }
+        } catch (const std::exception& error) {
+            fail(where + ": record " + std::to_string(record_id) + " cannot be played again: " + error.what());
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    const std::string path = (std::filesystem::temp_directory_path() / "belief_sg_game_record_test.bsgr").string();
+    std::filesystem::remove(path);
+
+    const std::vector<std::shared_ptr<Game>> games = {std::make_shared<KuhnPoker>(), std::make_shared<MiniStratego>()};
+    std::vector<std::pair<std::shared_ptr<Game>, History>> matches;
+    {
+        auto writer = std::make_shared<GameRecordWriter>(path);
+        for (std::uint64_t seed = 0; seed < 20; ++seed) {
+            const std::shared_ptr<Game>& game = games[seed % games.size()];
+            // Chance is drawn again from the seed without observations
+            matches.emplace_back(game, play(game, seed, writer, seed % 4 < 2));
+        }
+        writer->flush();
+    }
+    check_records(path, matches, "round trip");
+
+    // A writer interrupted in the middle of the last record
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    matches.pop_back();
+    check_records(path, matches, "truncated");
+    {
+        auto writer = std::make_shared<GameRecordWriter>(path);
+        matches.emplace_back(games[0], play(games[0], 100, writer, true));
+        writer->flush();
+    }
+    check_records(path, matches, "appended after truncation");
+
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << "not a record file";
+    }
+    try {
+        GameRecordWriter writer(path);
+        fail("a file that is not a record file is appended to");
+    } catch (const std::runtime_error&) {
+    }
+    std::filesystem::remove(path);
+
+    if (n_failures > 0) {
+        std::cerr << n_failures << " failures" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+// Compares the native collection model with a brute-force enumeration on random small
+// collections. After random removals and assignments, the model must fail exactly when no
+// assignment respects the counts, and otherwise keep in each domain exactly the values taken by
+// the piece in some assignment. Exits with a non-zero status on failure.
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Belief-SG/core/native_collection_model.h"
+
+namespace {
+
+using belief_sg::NativeCollectionModel;
+
+constexpr int kNTrials = 20000;
+constexpr int kMaxPieces = 8;
+constexpr int kMaxValues = 5;
+constexpr int kMaxCopies = 2;
+constexpr int kMaxChanges = 6;
+
+int n_failures = 0;
+
+void fail(const std::string& message) {
+    if (n_failures++ < 20) {
+        std::cerr << message << std::endl;
+    }
+}
+
+// Values taken by each piece over every assignment of the domains respecting the counts, all
+// empty if there is none
+class BruteForce {
+public:
+    BruteForce(std::vector<std::uint64_t> domains, std::vector<int> counts)
+            : domains_(std::move(domains)), left_(std::move(counts)),
+              assignment_(domains_.size()), supports_(domains_.size(), 0) {
+        enumerate(0);
+    }
+
+    [[nodiscard]] const std::vector<std::uint64_t>& supports() const {
+        return supports_;
+    }
+    [[nodiscard]] int n_solutions() const {
+        return n_solutions_;
+    }
+
+private:
+    void enumerate(std::size_t piece) {
+        if (piece == domains_.size()) {
+            n_solutions_++;
+            for (std::size_t id = 0; id < domains_.size(); id++) {
+                supports_[id] |= std::uint64_t{1} << assignment_[id];
+            }
+            return;
+        }
+        for (std::uint64_t values = domains_[piece]; values != 0; values &= values - 1) {
+            const int value = std::countr_zero(values);
+            if (left_[value] > 0) {
+                left_[value]--;
+                assignment_[piece] = value;
+                enumerate(piece + 1);
+                left_[value]++;
+            }
+        }
+    }
+
+    std::vector<std::uint64_t> domains_;
+    std::vector<int> left_;
+    std::vector<int> assignment_;
+    std::vector<std::uint64_t> supports_;
+    int n_solutions_ = 0;
+};
+
+void check(NativeCollectionModel& model, const std::vector<std::uint64_t>& domains, const std::vector<int>& counts, const std::string& where) {
+    const BruteForce brute_force(domains, counts);
+    const bool feasible = model.propagate();
+    if (feasible != (brute_force.n_solutions() > 0)) {
+        fail(where + (feasible ? ": the model has no solution but propagates" : ": the model fails but has a solution"));
+        return;
+    }
+    if (!feasible) {
+        return;
+    }
+    bool solved = true;
+    for (std::size_t id = 0; id < domains.size(); id++) {
+        std::uint64_t domain = 0;
+        for (int value : model.get_values(static_cast<int>(id))) {
+            domain |= std::uint64_t{1} << value;
+        }
+        if (domain != brute_force.supports()[id]) {
+            fail(where + ": piece " + std::to_string(id) + " keeps unsupported values or lost supported ones");
+            return;
+        }
+        solved = solved && std::popcount(domain) == 1;
+    }
+    if (model.is_solved() != solved) {
+        fail(where + ": is_solved disagrees with the domains");
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 generator(7);
+    for (int trial = 0; trial < kNTrials; trial++) {
+        const int n_values = 1 + static_cast<int>(generator() % kMaxValues);
+        std::vector<int> counts(n_values);
+        int n_pieces = 0;
+        for (int& count : counts) {
+            count = static_cast<int>(generator() % (kMaxCopies + 1));
+            n_pieces += count;
+        }
+        if (n_pieces == 0 || n_pieces > kMaxPieces) {
+            continue;
+        }
+        const std::string where = "trial " + std::to_string(trial);
+
+        NativeCollectionModel model(n_pieces, n_values);
+        model.add_counts(counts);
+        std::vector<std::uint64_t> domains(n_pieces, (std::uint64_t{1} << n_values) - 1);
+        const int n_changes = static_cast<int>(generator() % (kMaxChanges + 1));
+        for (int change = 0; change < n_changes; change++) {
+            const int id = static_cast<int>(generator() % n_pieces);
+            const int value = static_cast<int>(generator() % n_values);
+            if (generator() % 4 == 0) {
+                model.assign_value(id, value);
+                domains[id] &= std::uint64_t{1} << value;
+            } else {
+                model.remove_value(id, value);
+                domains[id] &= ~(std::uint64_t{1} << value);
+            }
+            // Intermediate propagations must not change the final result
+            if (generator() % 2 == 0) {
+                model.propagate();
+            }
+        }
+        check(model, domains, counts, where);
+
+        // A clone propagates on its own
+        if (model.has_solution()) {
+            std::unique_ptr<NativeCollectionModel> clone = model.clone_model();
+            const int id = static_cast<int>(generator() % n_pieces);
+            const int value = static_cast<int>(generator() % n_values);
+            clone->remove_value(id, value);
+            std::vector<std::uint64_t> clone_domains = domains;
+            clone_domains[id] &= ~(std::uint64_t{1} << value);
+            check(*clone, clone_domains, counts, where + " (clone)");
+            check(model, domains, counts, where + " (original after cloning)");
+        }
+    }
+    if (n_failures > 0) {
+        std::cerr << n_failures << " failures" << std::endl;
+        return 1;
+    }
+    return 0;
+}
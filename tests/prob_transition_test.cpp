@@ -0,0 +1,88 @@
+// Merges crafted transitions of Kuhn poker. Outcomes reaching equal states must merge, summing
+// their probabilities, while outcomes that leave the same board but removed different hidden cards
+// must stay apart. Exits with a non-zero status on failure.
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Belief-SG/core/point_of_view.h"
+#include "Belief-SG/core/position.h"
+#include "Belief-SG/core/prob_transition.h"
+#include "Belief-SG/core/state.h"
+#include "Belief-SG/games/kuhn_poker.h"
+
+namespace {
+
+using namespace belief_sg;
+
+int n_failures = 0;
+
+void fail(const std::string& message) {
+    if (n_failures++ < 20) {
+        std::cerr << message << std::endl;
+    }
+}
+
+void check_hash(const State& state, const std::string& where) {
+    if (state.hash() != state.compute_hash()) {
+        fail(where + ": the incremental hash differs from the recomputed one");
+    }
+}
+
+}  // namespace
+
+int main() {
+    const auto game = std::make_shared<KuhnPoker>();
+    // The three cards are in the deck, and the player 0 has seen the second one
+    State deck = game->initial_state(PointOfView(PointOfView::Type::Public));
+    deck.add_observers(Position(0, 1), {0});
+
+    // The unseen first card is removed
+    State first_removed = deck;
+    first_removed.remove_piece(Position(0, 0));
+    // The seen card is removed and the player 0 then sees the first one. The deck looks the same
+    // as above, but the removed card had been seen.
+    State seen_removed = deck;
+    seen_removed.remove_piece(Position(0, 1));
+    seen_removed.add_observers(Position(0, 0), {0});
+    // A card moved away and back is the same card
+    State moved_back = deck;
+    moved_back.move_piece(Position(0, 0), Position(1));
+    moved_back.move_piece(Position(1), Position(0, 0));
+    for (const State* state : {&deck, &first_removed, &seen_removed, &moved_back}) {
+        check_hash(*state, "crafted state");
+    }
+
+    std::vector<ProbTransition> transitions = {
+        {first_removed, 0.25},
+        {seen_removed, 0.25},
+        {first_removed, 0.125},
+        {moved_back, 0.25},
+        {deck, 0.125},
+    };
+    merge_duplicate_transitions(transitions);
+    if (transitions.size() != 3) {
+        fail(std::to_string(transitions.size()) + " transitions are left instead of 3");
+    } else {
+        if (!(transitions[0].state == first_removed) || transitions[0].probability != 0.375) {
+            fail("the removals of the unseen card are not merged in place");
+        }
+        if (!(transitions[1].state == seen_removed) || transitions[1].probability != 0.25) {
+            fail("the removal of the seen card is merged with that of the unseen one");
+        }
+        if (!(transitions[2].state == deck) || transitions[2].probability != 0.375) {
+            fail("the card moved back is not merged with the initial deck");
+        }
+    }
+    if (first_removed == seen_removed || first_removed.hash() == seen_removed.hash()) {
+        fail("states that removed different cards compare or hash equal");
+    }
+
+    if (n_failures > 0) {
+        std::cerr << n_failures << " failures" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Random playouts of every game from the world, public and private points of view. Along the way,
+// the incremental hash of each state must equal the hash recomputed from scratch, and two states
+// must have equal hashes exactly when they compare equal. Exits with a non-zero status on failure.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Belief-SG/core/action.h"
+#include "Belief-SG/core/game.h"
+#include "Belief-SG/core/player_id.h"
+#include "Belief-SG/core/point_of_view.h"
+#include "Belief-SG/core/state.h"
+#include "Belief-SG/games/agram.h"
+#include "Belief-SG/games/cuckoo.h"
+#include "Belief-SG/games/goofspiel.h"
+#include "Belief-SG/games/kuhn_poker.h"
+#include "Belief-SG/games/mini_stratego.h"
+
+namespace {
+
+using namespace belief_sg;
+
+// Only the first states of the playouts are compared pairwise, which is quadratic
+constexpr std::size_t kMaxComparedStates = 1500;
+constexpr int kMaxSteps = 60;
+
+int n_failures = 0;
+
+void fail(const std::string& message) {
+    if (n_failures++ < 20) {
+        std::cerr << message << std::endl;
+    }
+}
+
+void check_hash(const State& state, const std::string& where) {
+    if (state.hash() != state.compute_hash()) {
+        fail(where + ": the incremental hash differs from the recomputed one");
+    }
+}
+
+void check_playouts(const std::shared_ptr<Game>& game, int n_playouts, const PointOfView& point_of_view) {
+    const std::string where = game->name() + " from " + point_of_view.to_string();
+    std::mt19937 generator(42);
+    std::vector<State> states;
+    auto visit = [&](const State& state) {
+        check_hash(state, where);
+        if (states.size() < kMaxComparedStates) {
+            states.push_back(state);
+        }
+    };
+
+    for (int playout = 0; playout < n_playouts; ++playout) {
+        State state = game->initial_state(point_of_view);
+        visit(state);
+        for (int step = 0; step < kMaxSteps && !game->is_terminal(state); ++step) {
+            std::vector<Action> joint_action;
+            joint_action.reserve(state.current_players().size());
+            for (PlayerId player_id : state.current_players()) {
+                const std::vector<ProbAction> legal_actions = game->legal_actions(state, player_id);
+                joint_action.push_back(legal_actions[generator() % legal_actions.size()].action);
+            }
+            game->apply_joint_action_inplace(state, joint_action, generator);
+            visit(state);
+            if (point_of_view.type == PointOfView::Type::Public) {
+                for (PlayerId player_id = 0; player_id < game->num_players(); ++player_id) {
+                    visit(state.private_view(player_id));
+                }
+            }
+        }
+        State determinized = state;
+        determinized.determinize(generator, false);
+        visit(determinized);
+    }
+
+    for (std::size_t i = 0; i < states.size(); ++i) {
+        for (std::size_t j = i + 1; j < states.size(); ++j) {
+            const bool equal_hashes = states[i].hash() == states[j].hash();
+            if (equal_hashes != (states[i] == states[j])) {
+                fail(where + ": states " + std::to_string(i) + " and " + std::to_string(j) + (equal_hashes ? " have equal hashes but differ" : " are equal but have different hashes"));
+            }
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    const std::vector<std::pair<std::shared_ptr<Game>, int>> games = {
+        {std::make_shared<KuhnPoker>(), 60},
+        {std::make_shared<Goofspiel>(2), 30},
+        {std::make_shared<Agram>(3), 15},
+        {std::make_shared<Cuckoo>(3), 30},
+        {std::make_shared<MiniStratego>(), 8},
+    };
+    for (const auto& [game, n_playouts] : games) {
+        check_playouts(game, n_playouts, PointOfView(PointOfView::Type::World));
+        check_playouts(game, n_playouts, PointOfView(PointOfView::Type::Public));
+        for (PlayerId player_id = 0; player_id < game->num_players(); ++player_id) {
+            check_playouts(game, n_playouts, PointOfView(PointOfView::Type::Private, player_id));
+        }
+    }
+    if (n_failures > 0) {
+        std::cerr << n_failures << " failures" << std::endl;
+        return 1;
+    }
+    return 0;
+}